@@ -0,0 +1,193 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AFFINE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+//Affine is an object-to-world style transform: a 3x3 linear part plus a translation.
+//It is stored like a glm::mat4 (four columns of four floats, the last row always
+// (0,0,0,1)) so it converts for free, but composition skips the known row and
+// columns are combined four floats at a time with SSE (where available).
+//
+//It also remembers whether its linear part is a rotation (or reflection) times a
+// uniform scale; for those, the linear part itself can serve as the normal matrix
+// (the shaders renormalize), which saves an inverse-transpose per object.
+//
+//Translation and Scaling are cheaper to apply than a general Affine, so they
+// are separate types with their own products:
+//   Affine m = Translation(x, y, z) * rotation * Scaling(2.0f, 2.0f, 1.0f);
+
+struct Translation {
+	explicit Translation(glm::vec3 const &_t) : t(_t) { }
+	Translation(float x, float y, float z) : t(x, y, z) { }
+	glm::vec3 t;
+};
+
+struct Scaling {
+	explicit Scaling(glm::vec3 const &_s) : s(_s) { }
+	Scaling(float x, float y, float z) : s(x, y, z) { }
+	glm::vec3 s;
+	bool uniform() const { return s.x == s.y && s.y == s.z; }
+};
+
+struct Affine {
+	//identity:
+	constexpr Affine() : m{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}} { }
+	//linear part only, column by column (usable in constant expressions):
+	constexpr Affine(float xx, float xy, float xz, float yx, float yy, float yz, float zx, float zy, float zz, bool _uniform_scale)
+		: m{{xx, xy, xz, 0.0f}, {yx, yy, yz, 0.0f}, {zx, zy, zz, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}}, uniform_scale(_uniform_scale) { }
+	//from columns (x, y, z axes and translation):
+	Affine(glm::vec3 const &x, glm::vec3 const &y, glm::vec3 const &z, glm::vec3 const &t, bool _uniform_scale) : uniform_scale(_uniform_scale) {
+		set_column(0, x, 0.0f);
+		set_column(1, y, 0.0f);
+		set_column(2, z, 0.0f);
+		set_column(3, t, 1.0f);
+	}
+	Affine(Translation const &translation) : Affine() {
+		set_column(3, translation.t, 1.0f);
+	}
+	Affine(Scaling const &scaling) : Affine() {
+		m[0][0] = scaling.s.x;
+		m[1][1] = scaling.s.y;
+		m[2][2] = scaling.s.z;
+		uniform_scale = scaling.uniform();
+	}
+
+	alignas(16) float m[4][4]; //m[column][row], as in glm::mat4
+	bool uniform_scale = true;
+
+	glm::vec3 column(int c) const { return glm::vec3(m[c][0], m[c][1], m[c][2]); }
+	void set_column(int c, glm::vec3 const &v, float w) {
+		m[c][0] = v.x; m[c][1] = v.y; m[c][2] = v.z; m[c][3] = w;
+	}
+
+	glm::vec3 transform_point(glm::vec3 const &p) const {
+		return column(0) * p.x + column(1) * p.y + column(2) * p.z + column(3);
+	}
+
+	//largest factor by which the transform stretches lengths (e.g., for bounding spheres):
+	float max_scale() const {
+		if (uniform_scale) return glm::length(column(0));
+		return glm::max(glm::length(column(0)), glm::max(glm::length(column(1)), glm::length(column(2))));
+	}
+
+	//a matrix that transforms normals correctly up to length (callers normalize):
+	glm::mat3 normal_matrix() const {
+		glm::vec3 x = column(0), y = column(1), z = column(2);
+		if (uniform_scale) return glm::mat3(x, y, z);
+		//inverse-transpose = cofactor matrix / determinant; only the determinant's sign matters here:
+		float sign = (glm::dot(x, glm::cross(y, z)) < 0.0f ? -1.0f : 1.0f);
+		return glm::mat3(sign * glm::cross(y, z), sign * glm::cross(z, x), sign * glm::cross(x, y));
+	}
+
+	glm::mat4 to_mat4() const {
+		return glm::mat4(
+			m[0][0], m[0][1], m[0][2], m[0][3],
+			m[1][0], m[1][1], m[1][2], m[1][3],
+			m[2][0], m[2][1], m[2][2], m[2][3],
+			m[3][0], m[3][1], m[3][2], m[3][3]
+		);
+	}
+	glm::mat4x3 to_mat4x3() const {
+		return glm::mat4x3(column(0), column(1), column(2), column(3));
+	}
+};
+
+//Compile-time sine and cosine of an angle in degrees (exact at multiples of 90):
+constexpr double sin_degrees(double degrees) {
+	degrees -= 360.0 * int(degrees / 360.0);
+	if (degrees > 180.0) degrees -= 360.0;
+	if (degrees < -180.0) degrees += 360.0;
+	if (degrees == 0.0 || degrees == 180.0 || degrees == -180.0) return 0.0;
+	if (degrees == 90.0) return 1.0;
+	if (degrees == -90.0) return -1.0;
+	double x = degrees * 3.14159265358979323846 / 180.0;
+	double term = x, sum = x;
+	for (int n = 1; n < 12; ++n) {
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double cos_degrees(double degrees) {
+	return sin_degrees(degrees + 90.0);
+}
+
+//Right-handed rotation about a coordinate axis:
+enum RotationAxis { XAxis, YAxis, ZAxis };
+
+constexpr Affine rotation_degrees(RotationAxis axis, double degrees) {
+	float s = float(sin_degrees(degrees));
+	float c = float(cos_degrees(degrees));
+	return (axis == XAxis ? Affine(1.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, -s, c, true)
+	      : axis == YAxis ? Affine(c, 0.0f, -s, 0.0f, 1.0f, 0.0f, s, 0.0f, c, true)
+	      : Affine(c, s, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 1.0f, true));
+}
+
+//Fixed orientations are constants, built when compiling:
+//  constexpr Affine tilt = fixed_rotation< XAxis, 30 >;
+template< RotationAxis A, int Degrees >
+constexpr Affine fixed_rotation = rotation_degrees(A, Degrees);
+
+//general composition (a applied after b):
+inline Affine operator*(Affine const &a, Affine const &b) {
+	Affine ret;
+	ret.uniform_scale = a.uniform_scale && b.uniform_scale;
+#ifdef AFFINE_SSE
+	__m128 a0 = _mm_load_ps(a.m[0]);
+	__m128 a1 = _mm_load_ps(a.m[1]);
+	__m128 a2 = _mm_load_ps(a.m[2]);
+	__m128 a3 = _mm_load_ps(a.m[3]);
+	for (int c = 0; c < 4; ++c) {
+		__m128 r = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(a0, _mm_set1_ps(b.m[c][0])),
+			_mm_mul_ps(a1, _mm_set1_ps(b.m[c][1]))),
+			_mm_mul_ps(a2, _mm_set1_ps(b.m[c][2])));
+		if (c == 3) r = _mm_add_ps(r, a3); //(b's translation column has w = 1)
+		_mm_store_ps(ret.m[c], r);
+	}
+#else
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			ret.m[c][r] = a.m[0][r] * b.m[c][0] + a.m[1][r] * b.m[c][1] + a.m[2][r] * b.m[c][2] + (c == 3 ? a.m[3][r] : 0.0f);
+		}
+	}
+#endif
+	return ret;
+}
+
+//specialized compositions:
+inline Affine operator*(Translation const &a, Affine const &b) {
+	Affine ret = b;
+	ret.m[3][0] += a.t.x;
+	ret.m[3][1] += a.t.y;
+	ret.m[3][2] += a.t.z;
+	return ret;
+}
+
+inline Affine operator*(Affine const &a, Translation const &b) {
+	Affine ret = a;
+	ret.set_column(3, a.transform_point(b.t), 1.0f);
+	return ret;
+}
+
+inline Affine operator*(Affine const &a, Scaling const &b) {
+	Affine ret = a;
+	for (int r = 0; r < 3; ++r) {
+		ret.m[0][r] *= b.s.x;
+		ret.m[1][r] *= b.s.y;
+		ret.m[2][r] *= b.s.z;
+	}
+	ret.uniform_scale = a.uniform_scale && b.uniform();
+	return ret;
+}
+
+inline Affine operator*(Translation const &a, Scaling const &b) {
+	Affine ret = b;
+	ret.set_column(3, a.t, 1.0f);
+	return ret;
+}
@@ -0,0 +1,61 @@
+#include "DrawList.hpp"
+
+#include <algorithm>
+
+uint64_t make_sort_key(DrawPass pass, uint32_t mesh, float depth) {
+	//quantize depth from [-1,1] to 24 bits:
+	float d = std::min(std::max(0.5f * depth + 0.5f, 0.0f), 1.0f);
+	uint64_t depth_bits = uint64_t(d * float(0xffffff)) & 0xffffff;
+
+	uint64_t key = uint64_t(pass) << 63;
+	if (pass == OpaquePass) {
+		//pass:1 | mesh:24 | (unused):15 | depth:24
+		key |= uint64_t(mesh & 0xffffff) << 39;
+		key |= depth_bits;
+	} else {
+		//pass:1 | far-to-near depth:24 | mesh:24 | (unused):15
+		key |= (0xffffff - depth_bits) << 39;
+		key |= uint64_t(mesh & 0xffffff) << 15;
+	}
+	return key;
+}
+
+void DrawList::sort_packets() {
+	//least-significant-digit radix sort, one byte per pass;
+	// passes where every key has the same byte are skipped:
+	sort_scratch.reserve(packets.capacity());
+	sort_scratch.resize(packets.size());
+
+	uint64_t all_or = 0;
+	uint64_t all_and = ~uint64_t(0);
+	for (auto const &p : packets) {
+		all_or |= p.key;
+		all_and &= p.key;
+	}
+	uint64_t varying = all_or ^ all_and;
+
+	std::vector< DrawPacket > *from = &packets;
+	std::vector< DrawPacket > *to = &sort_scratch;
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		if (((varying >> shift) & 0xff) == 0) continue;
+
+		uint32_t offsets[256] = { 0 };
+		for (auto const &p : *from) {
+			offsets[(p.key >> shift) & 0xff] += 1;
+		}
+		uint32_t total = 0;
+		for (uint32_t b = 0; b < 256; ++b) {
+			uint32_t count = offsets[b];
+			offsets[b] = total;
+			total += count;
+		}
+		for (auto const &p : *from) {
+			(*to)[offsets[(p.key >> shift) & 0xff]++] = p;
+		}
+		std::swap(from, to);
+	}
+
+	if (from != &packets) {
+		packets.swap(sort_scratch);
+	}
+}
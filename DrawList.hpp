@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Affine.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//A DrawList is everything the renderer needs to produce one frame.
+//Game::draw fills one in (without touching OpenGL); the renderer consumes it,
+// possibly on another thread, so it must not point into game state.
+
+//Draws are ordered by 64-bit sort keys:
+// opaque draws come first, grouped by mesh, front-to-back within a mesh (for early-z);
+// translucent draws come last, back-to-front (for correct blending), then by mesh.
+//(every draw in a frame uses the same shading program, so programs aren't part of the key)
+enum DrawPass : uint8_t {
+	OpaquePass = 0,
+	TranslucentPass = 1,
+};
+
+//'depth' is normalized device z in [-1,1] (smaller is nearer); 'mesh' is any
+// per-mesh identifier (only the low 24 bits are used):
+uint64_t make_sort_key(DrawPass pass, uint32_t mesh, float depth);
+
+inline DrawPass sort_key_pass(uint64_t key) { return DrawPass(key >> 63); }
+
+//How (and how often) lighting is evaluated; trades quality for fragment cost:
+enum ShadingTier : uint8_t {
+	PerPixelShading = 0, //per fragment
+	PerVertexShading = 1, //per vertex (Gouraud)
+	BakedShading = 2, //static scenery pre-lit into its vertex colors, everything else per vertex
+};
+uint32_t const ShadingTiers = 3;
+
+//One mesh draw:
+struct DrawPacket {
+	uint64_t key = 0; //sort key (see make_sort_key)
+	GLint first = 0; //mesh range in the mesh vertex buffer
+	GLsizei count = 0;
+	Affine object_to_world;
+};
+
+struct DrawList {
+	glm::uvec2 drawable_size = glm::uvec2(0);
+	ShadingTier shading_tier = PerPixelShading;
+	std::chrono::steady_clock::time_point input_time; //when the input this frame reflects was sampled
+
+	//camera:
+	glm::mat4 world_to_clip = glm::mat4(1.0f);
+	glm::vec2 view_min = glm::vec2(0.0f); //world-space rectangle that maps to the viewport
+	glm::vec2 view_max = glm::vec2(0.0f);
+
+	//dynamic objects, already culled:
+	std::vector< DrawPacket > packets;
+
+	//radix sort 'packets' by key (stable):
+	void sort_packets();
+	std::vector< DrawPacket > sort_scratch; //(kept to avoid reallocation)
+
+	//static scenery; the renderer bakes these to world space (clipped to the view)
+	// whenever 'scenery_version' or the view changes:
+	std::vector< DrawPacket > scenery;
+	uint32_t scenery_version = 0;
+
+	//HUD egg tally: instances are xyz offset + xy scale (the renderer expands them to transforms);
+	// the renderer re-uploads them only when 'hud_version' changes:
+	std::vector< glm::vec4 > hud_instances;
+	DrawPacket hud_egg_mesh; //(object_to_world unused)
+	DrawPacket hud_golden_egg_mesh;
+	GLsizei hud_egg_count = 0; //first hud_egg_count instances use hud_egg_mesh, rest use hud_golden_egg_mesh
+	uint32_t hud_version = 0;
+
+	//bookkeeping from the producer:
+	uint32_t culled = 0; //objects dropped before reaching the list
+};
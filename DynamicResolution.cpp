@@ -0,0 +1,134 @@
+#include "DynamicResolution.hpp"
+
+#include "gl_state.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DynamicResolution::DynamicResolution() {
+	for (auto &q : queries) {
+		glGenQueries(1, &q.query);
+	}
+}
+
+DynamicResolution::~DynamicResolution() {
+	for (auto &q : queries) {
+		glDeleteQueries(1, &q.query);
+		q.query = 0;
+	}
+	if (framebuffer) {
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+	if (color_renderbuffer) {
+		glDeleteRenderbuffers(1, &color_renderbuffer);
+		color_renderbuffer = 0;
+	}
+	if (depth_renderbuffer) {
+		glDeleteRenderbuffers(1, &depth_renderbuffer);
+		depth_renderbuffer = 0;
+	}
+}
+
+glm::uvec2 DynamicResolution::begin_frame(glm::uvec2 new_drawable_size) {
+	drawable_size = new_drawable_size;
+	if (!enabled) scale = 1.0f;
+
+	render_size = glm::max(glm::uvec2(1), glm::uvec2(glm::vec2(drawable_size) * scale + 0.5f));
+	render_size = glm::min(render_size, drawable_size);
+
+	if (render_size != drawable_size) {
+		//(re)allocate the offscreen target if the drawable outgrew it:
+		if (target_size.x < drawable_size.x || target_size.y < drawable_size.y) {
+			target_size = drawable_size;
+			if (!framebuffer) {
+				glGenFramebuffers(1, &framebuffer);
+				glGenRenderbuffers(1, &color_renderbuffer);
+				glGenRenderbuffers(1, &depth_renderbuffer);
+			}
+			glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, target_size.x, target_size.y);
+			glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, target_size.x, target_size.y);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+				throw std::runtime_error("DynamicResolution: offscreen framebuffer is incomplete.");
+			}
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		//(keep clears from touching the unused part of the target)
+		gl_state.enable(GL_SCISSOR_TEST);
+		glScissor(0, 0, render_size.x, render_size.y);
+	} else {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	//time the frame, unless the query slot is still waiting on an older frame:
+	auto &q = queries[next_query];
+	timing = false;
+	if (enabled && !q.pending) {
+		glBeginQuery(GL_TIME_ELAPSED, q.query);
+		q.pending = true;
+		q.scale = scale;
+		timing = true;
+	}
+
+	return render_size;
+}
+
+void DynamicResolution::end_frame() {
+	if (timing) {
+		glEndQuery(GL_TIME_ELAPSED);
+		next_query = (next_query + 1) % Queries;
+		timing = false;
+	}
+
+	if (render_size != drawable_size) {
+		//upscale into the default framebuffer (blits are scissored too):
+		gl_state.disable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(
+			0, 0, render_size.x, render_size.y,
+			0, 0, drawable_size.x, drawable_size.y,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR
+		);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	//read back whichever timings have finished (oldest first, never waiting):
+	for (uint32_t i = 0; i < Queries; ++i) {
+		auto &q = queries[(next_query + i) % Queries];
+		if (!q.pending) continue;
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE) break; //(later queries can't be done either)
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(q.query, GL_QUERY_RESULT, &ns);
+		q.pending = false;
+		update_scale(q.scale, float(ns) * 1.0e-6f);
+	}
+}
+
+void DynamicResolution::update_scale(float sample_scale, float sample_ms) {
+	//GPU time is roughly proportional to pixels drawn (i.e. scale^2), so track what
+	// a full-resolution frame would cost:
+	float sample_full_ms = sample_ms / (sample_scale * sample_scale);
+	full_ms = (full_ms == 0.0f ? sample_full_ms : 0.9f * full_ms + 0.1f * sample_full_ms);
+	gpu_ms = full_ms * scale * scale;
+
+	//leave some slack below the budget so that scale doesn't bounce off it:
+	float low = 0.75f * budget_ms;
+	if (gpu_ms <= budget_ms && (gpu_ms >= low || scale >= 1.0f)) return;
+
+	//aim for the middle of [low,budget], moving gradually and in coarse steps:
+	float want = std::sqrt(0.5f * (low + budget_ms) / std::max(full_ms, 0.01f));
+	want = std::min(std::max(want, scale * 0.9f), scale * 1.05f);
+	want = std::round(want * 32.0f) / 32.0f;
+	scale = std::min(std::max(want, min_scale), 1.0f);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+//DynamicResolution renders frames into an offscreen target at a fraction of the
+// drawable size and upscales them, picking the fraction from measured GPU time
+// so that frames fit a time budget:
+// - GPU time comes from GL_TIME_ELAPSED queries, read back (without waiting)
+//   a few frames later;
+// - the target is allocated at the full drawable size and only its lower-left
+//   corner is used, so changing the scale never reallocates;
+// - at full scale, frames go straight to the default framebuffer.
+//
+//Must be created, used, and destroyed with the GL context current.
+
+struct DynamicResolution {
+	DynamicResolution();
+	~DynamicResolution();
+
+	//start a frame for a drawable of 'drawable_size'; binds the framebuffer to
+	// draw into and returns the size of the region to draw (set the viewport to it):
+	glm::uvec2 begin_frame(glm::uvec2 drawable_size);
+
+	//finish the frame: upscale into the default framebuffer (if needed) and
+	// feed any finished timings to the governor:
+	void end_frame();
+
+	//governor settings:
+	bool enabled = true;
+	float budget_ms = 14.0f; //GPU time to aim for (a bit under a 60Hz frame)
+	float min_scale = 0.5f; //don't go blurrier than this (fraction of drawable width/height)
+
+	float scale = 1.0f; //current fraction of the drawable size being rendered
+	float gpu_ms = 0.0f; //(estimated) GPU frame time at the current scale
+
+	//target (framebuffer 0 when rendering at full scale):
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+	glm::uvec2 target_size = glm::uvec2(0); //allocated size
+
+private:
+	void update_scale(float sample_scale, float sample_ms);
+
+	glm::uvec2 drawable_size = glm::uvec2(0);
+	glm::uvec2 render_size = glm::uvec2(0);
+	float full_ms = 0.0f; //smoothed GPU frame time, scaled up to full resolution
+
+	//timer queries, used round-robin:
+	enum { Queries = 4 };
+	struct {
+		GLuint query = 0;
+		bool pending = false; //issued, result not yet read
+		float scale = 1.0f; //scale of the frame it timed
+	} queries[Queries];
+	uint32_t next_query = 0;
+	bool timing = false; //query active for the current frame?
+};
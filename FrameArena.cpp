@@ -0,0 +1,37 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+FrameArena::FrameArena(size_t _capacity) : capacity(_capacity), block(new uint8_t[_capacity]) {
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	used += size;
+
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (start + size <= capacity) {
+		offset = start + size;
+		return block.get() + start;
+	}
+
+	//doesn't fit; this frame spills to the heap:
+	//(new[] is aligned for any fundamental type; over-aligned requests get padding)
+	overflow.emplace_back(new uint8_t[size + alignment]);
+	uintptr_t address = reinterpret_cast< uintptr_t >(overflow.back().get());
+	return reinterpret_cast< void * >((address + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+void FrameArena::reset() {
+	high_water = std::max(high_water, used);
+	if (!overflow.empty()) {
+		//grow so that a frame like the last one fits in one block:
+		overflow.clear();
+		capacity = std::max(capacity * 2, used + used / 2);
+		block.reset(new uint8_t[capacity]);
+		grows += 1;
+	}
+	offset = 0;
+	used = 0;
+}
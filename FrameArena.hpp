@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#define FRAME_ARENA_PMR 1
+#endif
+
+//FrameArena hands out memory for data that only lives for one frame:
+// allocating bumps a pointer, nothing is freed on its own, and reset() (at the
+// start of each frame) recycles everything at once.
+//If a frame needs more than the arena holds, the overflow comes from the heap,
+// and the next reset() replaces it all with one block big enough for that frame,
+// so steady-state frames never touch the heap.
+//Objects placed in the arena are not destroyed; use it for trivially destructible data.
+//
+//With C++17, FrameArena is also a std::pmr::memory_resource.
+
+struct FrameArena
+#ifdef FRAME_ARENA_PMR
+	: std::pmr::memory_resource
+#endif
+{
+	FrameArena(size_t capacity);
+	FrameArena(FrameArena const &) = delete;
+	FrameArena &operator=(FrameArena const &) = delete;
+
+	void *allocate(size_t size, size_t alignment);
+	void reset();
+
+	size_t capacity = 0; //size of the main block
+	size_t used = 0; //bytes handed out since the last reset (all blocks)
+	size_t high_water = 0; //most bytes ever used in one frame
+	uint32_t grows = 0; //times the main block was replaced by a bigger one
+
+	std::unique_ptr< uint8_t[] > block;
+	size_t offset = 0; //bump pointer within 'block'
+	std::vector< std::unique_ptr< uint8_t[] > > overflow;
+
+#ifdef FRAME_ARENA_PMR
+private:
+	void *do_allocate(size_t size, size_t alignment) override { return allocate(size, alignment); }
+	void do_deallocate(void *, size_t, size_t) override { }
+	bool do_is_equal(std::pmr::memory_resource const &other) const noexcept override { return this == &other; }
+#endif
+};
+
+//Standard-library allocator that draws from a FrameArena (deallocation is a no-op):
+//   FrameVector< float > depths(&arena);
+template< typename T >
+struct ArenaAllocator {
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena *_arena) : arena(_arena) { }
+	template< typename U >
+	ArenaAllocator(ArenaAllocator< U > const &other) : arena(other.arena) { }
+
+	T *allocate(size_t count) {
+		return static_cast< T * >(arena->allocate(sizeof(T) * count, alignof(T)));
+	}
+	void deallocate(T *, size_t) { }
+
+	FrameArena *arena;
+};
+
+template< typename T, typename U >
+bool operator==(ArenaAllocator< T > const &a, ArenaAllocator< U > const &b) { return a.arena == b.arena; }
+template< typename T, typename U >
+bool operator!=(ArenaAllocator< T > const &a, ArenaAllocator< U > const &b) { return a.arena != b.arena; }
+
+template< typename T >
+using FrameVector = std::vector< T, ArenaAllocator< T > >;
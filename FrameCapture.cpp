@@ -0,0 +1,156 @@
+#include "FrameCapture.hpp"
+
+#include "gl_state.hpp"
+#include "save_png.hpp"
+#include "worker_threads.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+FrameCapture::FrameCapture(std::string const &_prefix, uint32_t workers) : prefix(_prefix) {
+	if (workers == 0) {
+		workers = default_worker_threads();
+	}
+	for (uint32_t i = 0; i < workers; ++i) {
+		threads.emplace_back(&FrameCapture::work, this);
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	finish();
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	jobs_changed.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	for (auto &readback : readbacks) {
+		if (readback.buffer) {
+			glDeleteBuffers(1, &readback.buffer);
+			gl_state.forget_buffer(readback.buffer);
+			readback.buffer = 0;
+		}
+	}
+}
+
+void FrameCapture::capture(glm::uvec2 size, uint32_t number) {
+	if (size.x == 0 || size.y == 0) return;
+
+	Readback &readback = readbacks[next_readback];
+	next_readback = (next_readback + 1) % Readbacks;
+
+	//the slot's previous readback is a full ring old by now; collect it (waiting only if the GPU is really behind):
+	if (readback.fence && !collect(readback, false)) {
+		readback_waits += 1;
+		collect(readback, true);
+	}
+
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+	if (!readback.buffer) glGenBuffers(1, &readback.buffer);
+	gl_state.bind_buffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	if (readback.buffer_size != bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		readback.buffer_size = bytes;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (GLbyte *)0);
+	gl_state.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.size = size;
+	readback.number = number;
+
+	//hand off whatever older readbacks have finished meanwhile (oldest first):
+	for (uint32_t i = 0; i + 1 < Readbacks; ++i) {
+		Readback &older = readbacks[(next_readback + i) % Readbacks];
+		if (older.fence && !collect(older, false)) break;
+	}
+}
+
+bool FrameCapture::collect(Readback &readback, bool wait) {
+	assert(readback.fence);
+	GLenum result = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GL_TIMEOUT_IGNORED : 0);
+	if (result == GL_TIMEOUT_EXPIRED) return false;
+	glDeleteSync(readback.fence);
+	readback.fence = 0;
+	if (result == GL_WAIT_FAILED) { //(the fence will never pass, so give up on this frame)
+		std::cerr << "WARNING: failed to wait for readback of frame " << readback.number << "; dropping it." << std::endl;
+		return true;
+	}
+
+	Job job;
+	char number[16];
+	std::snprintf(number, sizeof(number), "%05u", readback.number);
+	job.filename = prefix + number + ".png";
+	job.size = readback.size;
+	{ //reuse pixel storage from an earlier job, if any; also apply backpressure so that a slow disk can't pile up frames:
+		std::unique_lock< std::mutex > lock(mutex);
+		jobs_changed.wait(lock, [this](){ return jobs.size() < 2 * threads.size(); });
+		if (!spare_pixels.empty()) {
+			job.pixels = std::move(spare_pixels.back());
+			spare_pixels.pop_back();
+		}
+	}
+	job.pixels.resize(readback.buffer_size);
+
+	gl_state.bind_buffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.buffer_size, GL_MAP_READ_BIT);
+	if (mapped) {
+		std::memcpy(job.pixels.data(), mapped, readback.buffer_size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	gl_state.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!mapped) {
+		std::cerr << "WARNING: failed to map readback of frame " << readback.number << "." << std::endl;
+		return true;
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		jobs.emplace_back(std::move(job));
+	}
+	jobs_changed.notify_one();
+	captured += 1;
+	return true;
+}
+
+void FrameCapture::finish() {
+	//collect outstanding readbacks, oldest first:
+	for (uint32_t i = 0; i < Readbacks; ++i) {
+		Readback &readback = readbacks[(next_readback + i) % Readbacks];
+		if (readback.fence) collect(readback, true);
+	}
+	//wait for the workers to drain the queue:
+	std::unique_lock< std::mutex > lock(mutex);
+	jobs_changed.wait(lock, [this](){ return jobs.empty() && encoding == 0; });
+}
+
+void FrameCapture::work() {
+	std::unique_lock< std::mutex > lock(mutex);
+	while (true) {
+		jobs_changed.wait(lock, [this](){ return quit || !jobs.empty(); });
+		if (jobs.empty()) break; //(quit, and nothing left to do)
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		encoding += 1;
+		lock.unlock();
+		jobs_changed.notify_all(); //(room in the queue)
+
+		try {
+			save_png(job.filename, job.size, job.pixels.data());
+		} catch (std::exception &e) {
+			std::cerr << "WARNING: " << e.what() << std::endl;
+		}
+
+		lock.lock();
+		spare_pixels.emplace_back(std::move(job.pixels));
+		encoding -= 1;
+		jobs_changed.notify_all(); //(finish() may be waiting)
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//FrameCapture saves rendered frames as PNGs without stalling the render loop:
+// - capture() starts an asynchronous glReadPixels into one of a ring of pixel
+//   buffer objects (and fences it);
+// - a couple of frames later, once the fence has passed, the buffer is mapped
+//   and its pixels are handed to a pool of worker threads for PNG encoding.
+//Frames are written as prefix + "NNNNN.png".
+//
+//capture()/finish() must be called with the GL context current; the workers
+// never touch GL.
+
+struct FrameCapture {
+	FrameCapture(std::string const &prefix, uint32_t workers = 0); //0 workers = pick from core count
+	~FrameCapture(); //calls finish()
+
+	//start reading back the current contents of the default framebuffer (of size 'size') as frame 'number':
+	void capture(glm::uvec2 size, uint32_t number);
+
+	//hand every outstanding readback to the workers and wait for all PNGs to be written:
+	void finish();
+
+	std::string prefix;
+
+	//counters:
+	uint64_t captured = 0; //frames written (or being written)
+	uint64_t readback_waits = 0; //times a readback wasn't ready when its slot was needed
+
+private:
+	//readback ring:
+	struct Readback {
+		GLuint buffer = 0;
+		GLsizeiptr buffer_size = 0;
+		GLsync fence = 0; //non-null while a readback is in flight
+		glm::uvec2 size = glm::uvec2(0);
+		uint32_t number = 0;
+	};
+	enum { Readbacks = 3 };
+	Readback readbacks[Readbacks];
+	uint32_t next_readback = 0;
+
+	//map a finished (or, if 'wait', unfinished) readback and queue it for encoding;
+	// returns false if not ready (a readback whose wait fails is dropped):
+	bool collect(Readback &readback, bool wait);
+
+	//encoding jobs:
+	struct Job {
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+		std::vector< uint8_t > pixels;
+	};
+	std::mutex mutex;
+	std::condition_variable jobs_changed;
+	std::deque< Job > jobs; //waiting to be encoded
+	std::vector< std::vector< uint8_t > > spare_pixels; //recycled pixel storage
+	uint32_t encoding = 0; //jobs being encoded right now
+	bool quit = false;
+	std::vector< std::thread > threads;
+
+	void work();
+};
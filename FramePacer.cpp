@@ -0,0 +1,89 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void FramePacer::wait_for_next_frame() {
+	auto now = PacingClock::now();
+	if (max_fps != 0 && started) {
+		auto period = std::chrono::duration_cast< PacingClock::duration >(std::chrono::duration< double >(1.0 / max_fps));
+		deadline += period;
+		if (deadline < now) {
+			deadline = now; //(fell behind; don't try to catch up)
+		} else {
+			std::this_thread::sleep_until(deadline);
+			now = PacingClock::now();
+		}
+	} else {
+		deadline = now;
+	}
+
+	if (started) {
+		frame_ms.add(std::chrono::duration< double, std::milli >(now - previous).count());
+	}
+	previous = now;
+	started = true;
+}
+
+GPUFrameQueue::GPUFrameQueue(uint32_t _max_frames_in_flight) : max_frames_in_flight(std::max(1U, _max_frames_in_flight)) {
+}
+
+GPUFrameQueue::~GPUFrameQueue() {
+	for (auto &frame : frames) {
+		glDeleteSync(frame.fence);
+		free_timestamps.emplace_back(frame.timestamp);
+	}
+	frames.clear();
+	if (!free_timestamps.empty()) {
+		glDeleteQueries(GLsizei(free_timestamps.size()), free_timestamps.data());
+		free_timestamps.clear();
+	}
+}
+
+void GPUFrameQueue::retire(bool wait) {
+	while (!frames.empty()) {
+		Frame &frame = frames.front();
+		GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			if (!wait) return;
+			waits += 1;
+			do {
+				result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms
+			} while (result == GL_TIMEOUT_EXPIRED);
+			wait = false; //(only block for the oldest frame)
+		}
+		//(the fence has passed, so the timestamp is ready; it maps onto the CPU clock
+		// through the pair of clock readings taken at end_frame)
+		GLuint64 done_gpu_time = 0;
+		glGetQueryObjectui64v(frame.timestamp, GL_QUERY_RESULT, &done_gpu_time);
+		double gpu_ms = std::max(0.0, double(GLint64(done_gpu_time) - frame.submit_gpu_time) * 1.0e-6);
+		double cpu_ms = std::chrono::duration< double, std::milli >(frame.submit_time - frame.input_time).count();
+		latency_ms.add(cpu_ms + gpu_ms);
+		glDeleteSync(frame.fence);
+		free_timestamps.emplace_back(frame.timestamp);
+		frames.pop_front();
+	}
+}
+
+void GPUFrameQueue::begin_frame() {
+	retire(false);
+	while (frames.size() >= max_frames_in_flight) {
+		retire(true);
+	}
+}
+
+void GPUFrameQueue::end_frame(PacingClock::time_point input_time) {
+	Frame frame;
+	if (free_timestamps.empty()) {
+		glGenQueries(1, &frame.timestamp);
+	} else {
+		frame.timestamp = free_timestamps.back();
+		free_timestamps.pop_back();
+	}
+	glQueryCounter(frame.timestamp, GL_TIMESTAMP);
+	glGetInteger64v(GL_TIMESTAMP, &frame.submit_gpu_time);
+	frame.submit_time = PacingClock::now();
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame.input_time = input_time;
+	frames.emplace_back(frame);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+//Frame pacing:
+// - FramePacer (main thread) optionally caps the frame rate by sleeping *before*
+//   input is sampled, so that the sampled input is as fresh as possible, and
+//   keeps frame-time statistics;
+// - GPUFrameQueue (render thread) bounds how many frames the driver may have
+//   queued (with fences), and measures input-to-GPU-done latency for each frame
+//   (photons follow at the next scanout). The GPU's finishing time comes from a
+//   GL_TIMESTAMP query, so the measurement doesn't depend on when it is read back.
+
+typedef std::chrono::steady_clock PacingClock;
+
+//mean/variance/max of a series of samples (Welford's method):
+struct RunningStats {
+	uint64_t count = 0;
+	double mean = 0.0;
+	double m2 = 0.0; //sum of squared differences from the mean
+	double max = 0.0;
+
+	void add(double sample) {
+		count += 1;
+		double delta = sample - mean;
+		mean += delta / double(count);
+		m2 += delta * (sample - mean);
+		if (count == 1 || sample > max) max = sample;
+	}
+	double variance() const { return count > 1 ? m2 / double(count - 1) : 0.0; }
+};
+
+struct FramePacer {
+	uint32_t max_fps = 0; //0 = no cap (e.g., rely on vsync)
+
+	//call at the top of the frame, just before polling input; sleeps as needed for
+	// the cap and records the time since the previous call:
+	void wait_for_next_frame();
+
+	RunningStats frame_ms; //time between frames
+
+private:
+	PacingClock::time_point deadline;
+	PacingClock::time_point previous;
+	bool started = false;
+};
+
+//Must be used (and destroyed) with the GL context current:
+struct GPUFrameQueue {
+	GPUFrameQueue(uint32_t max_frames_in_flight);
+	~GPUFrameQueue();
+
+	//call before drawing a frame; waits until fewer than max_frames_in_flight are queued:
+	void begin_frame();
+	//call after the frame's swap; 'input_time' is when the frame's input was sampled:
+	void end_frame(PacingClock::time_point input_time);
+
+	uint32_t max_frames_in_flight;
+
+	RunningStats latency_ms; //input sampled -> GPU done with the frame (by GPU timestamp)
+	uint64_t waits = 0; //times begin_frame had to block
+
+private:
+	struct Frame {
+		GLsync fence = 0;
+		GLuint timestamp = 0; //query: GPU time when the frame was done
+		PacingClock::time_point input_time;
+		PacingClock::time_point submit_time; //CPU time at end_frame...
+		GLint64 submit_gpu_time = 0; //...and the GPU time then
+	};
+	std::deque< Frame > frames; //in flight, oldest first
+	std::vector< GLuint > free_timestamps; //(recycled query objects)
+
+	//retire frames whose fences have passed (blocking on the oldest if 'wait'):
+	void retire(bool wait);
+};
@@ -1,23 +1,19 @@
 #include "Game.hpp"
 
-#include "gl_errors.hpp" //helper for dumpping OpenGL error messages
-#include "read_chunk.hpp" //helper for reading a vector of structures from a file
-#include "data_path.hpp" //helper to get paths relative to executable
+#include "frustum_cull.hpp" //helper for testing bounding spheres against the view
 
 #include <glm/gtc/type_ptr.hpp>
-#include <glm/gtc/random.hpp>
 
 #include <iostream>
-#include <fstream>
-#include <map>
-#include <cstddef>
+#include <algorithm>
 #include <random>
 #include <cmath>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
 
 #define PI 3.141592f
 
-#define NUM_TARGETS 10
-
 // Some helpful functions for vectors
 float mag(glm::vec2 vec) {
 	return glm::sqrt(vec.x * vec.x + vec.y * vec.y);
@@ -27,219 +23,137 @@ void normalize(glm::vec2 &vec) {
 	vec /= mag(vec);
 }
 
-Game::Target Game::create_target(bool golden) {
-	Target target = Target();
-	target.mesh = golden ? golden_egg_mesh : target_mesh;
-	target.points = 10;
-	target.golden = golden;
-	target.position.y = glm::linearRand(1.0f, 9.0f);
-	target.position.x = glm::linearRand(-4.5f, 4.5f);
-
-	//std::cout << "Position" << target.position.x << target.position.y << std::endl;
-
-	return target;
-}
-
-//helper defined later; throws if shader compilation fails:
-static GLuint compile_shader(GLenum type, std::string const &source);
-
-Game::Game() {
-	{ //create an opengl program to perform sun/sky (well, directional+hemispherical) lighting:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
-			"#version 330\n"
-			"uniform mat4 object_to_clip;\n"
-			"uniform mat4x3 object_to_light;\n"
-			"uniform mat3 normal_to_light;\n"
-			"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
-			"in vec3 Normal;\n"
-			"in vec4 Color;\n"
-			"out vec3 position;\n"
-			"out vec3 normal;\n"
-			"out vec4 color;\n"
-			"void main() {\n"
-			"	gl_Position = object_to_clip * Position;\n"
-			"	position = object_to_light * Position;\n"
-			"	normal = normal_to_light * Normal;\n"
-			"	color = Color;\n"
-			"}\n"
-		);
+//which way an enemy's cube turns shows its AI state:
+static Game::Facing enemy_facing(Game::EnemyState state, bool golden_active) {
+	if (golden_active) return Game::FacingGolden;
+	switch(state) {
+		case Game::chase:
+		case Game::hunt:
+			return Game::FacingAggressive;
+		case Game::patrol:
+		case Game::circle:
+			return Game::FacingPatrol;
+		case Game::wander:
+		case Game::flee:
+			return Game::FacingMindless;
+	}
+	return Game::FacingNone;
+}
 
-		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
-			"#version 330\n"
-			"uniform vec3 sun_direction;\n"
-			"uniform vec3 sun_color;\n"
-			"uniform vec3 sky_direction;\n"
-			"uniform vec3 sky_color;\n"
-			"in vec3 position;\n"
-			"in vec3 normal;\n"
-			"in vec4 color;\n"
-			"out vec4 fragColor;\n"
-			"void main() {\n"
-			"	vec3 total_light = vec3(0.0, 0.0, 0.0);\n"
-			"	vec3 n = normalize(normal);\n"
-			"	{ //sky (hemisphere) light:\n"
-			"		vec3 l = sky_direction;\n"
-			"		float nl = 0.5 + 0.5 * dot(n,l);\n"
-			"		total_light += nl * sky_color;\n"
-			"	}\n"
-			"	{ //sun (directional) light:\n"
-			"		vec3 l = sun_direction;\n"
-			"		float nl = max(0.0, dot(n,l));\n"
-			"		total_light += nl * sun_color;\n"
-			"	}\n"
-			"	fragColor = vec4(color.rgb * total_light, color.a);\n"
-			"}\n"
-		);
+World::Entity Game::spawn_player() {
+	Renderable renderable;
+	renderable.mesh = player_mesh;
+	renderable.z = -0.5f;
+	Body body;
+	body.radius = 0.2f;
+	return world.create(Position(), Velocity(), body, renderable);
+}
 
-		simple_shading.program = glCreateProgram();
-		glAttachShader(simple_shading.program, vertex_shader);
-		glAttachShader(simple_shading.program, fragment_shader);
-		//shaders are reference counted so this makes sure they are freed after program is deleted:
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
-
-		//link the shader program and throw errors if linking fails:
-		glLinkProgram(simple_shading.program);
-		GLint link_status = GL_FALSE;
-		glGetProgramiv(simple_shading.program, GL_LINK_STATUS, &link_status);
-		if (link_status != GL_TRUE) {
-			std::cerr << "Failed to link shader program." << std::endl;
-			GLint info_log_length = 0;
-			glGetProgramiv(simple_shading.program, GL_INFO_LOG_LENGTH, &info_log_length);
-			std::vector< GLchar > info_log(info_log_length, 0);
-			GLsizei length = 0;
-			glGetProgramInfoLog(simple_shading.program, GLsizei(info_log.size()), &length, &info_log[0]);
-			std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-			throw std::runtime_error("failed to link program");
+World::Entity Game::spawn_enemy(glm::vec2 position, float speed, EnemyState state, float state_seconds) {
+	Position at;
+	at.value = position;
+	Heading heading;
+	heading.direction = rng.range(0.0f, 360.0f);
+	heading.speed = speed;
+	Confined confined;
+	confined.min = glm::vec2(-4.8f, 0.3f);
+	confined.max = glm::vec2(4.8f, 9.5f);
+	Body body;
+	body.radius = 0.2f;
+	Renderable renderable;
+	renderable.mesh = enemy_mesh;
+	renderable.z = -0.5f;
+	EnemyAI ai;
+	ai.state = state;
+	ai.serial = enemy_serial++;
+	if (golden_active) {
+		ai.state = flee; //(picks a state of its own when golden mode ends)
+	}
+	renderable.facing = enemy_facing(ai.state, golden_active);
+	World::Entity enemy = world.create(at, heading, confined, body, Hazard(), ai, renderable);
+
+	EnemyAI &created = *world.get< EnemyAI >(enemy);
+	Event event;
+	event.entity = enemy;
+	if (golden_active) {
+		ai_due.emplace_back(enemy);
+	} else {
+		event.kind = Event::EnemyStateChange;
+		created.state_timer = timers.schedule(timers.now + uint64_t(state_seconds * TicksPerSecond), event);
+		if (state == patrol) {
+			event.kind = Event::PatrolTurn;
+			created.patrol_timer = timers.schedule(timers.now + 3 * TicksPerSecond, event);
 		}
 	}
+	return enemy;
+}
 
-	{ //read back uniform and attribute locations from the shader program:
-		simple_shading.object_to_clip_mat4 = glGetUniformLocation(simple_shading.program, "object_to_clip");
-		simple_shading.object_to_light_mat4x3 = glGetUniformLocation(simple_shading.program, "object_to_light");
-		simple_shading.normal_to_light_mat3 = glGetUniformLocation(simple_shading.program, "normal_to_light");
-
-		simple_shading.sun_direction_vec3 = glGetUniformLocation(simple_shading.program, "sun_direction");
-		simple_shading.sun_color_vec3 = glGetUniformLocation(simple_shading.program, "sun_color");
-		simple_shading.sky_direction_vec3 = glGetUniformLocation(simple_shading.program, "sky_direction");
-		simple_shading.sky_color_vec3 = glGetUniformLocation(simple_shading.program, "sky_color");
-
-		simple_shading.Position_vec4 = glGetAttribLocation(simple_shading.program, "Position");
-		simple_shading.Normal_vec3 = glGetAttribLocation(simple_shading.program, "Normal");
-		simple_shading.Color_vec4 = glGetAttribLocation(simple_shading.program, "Color");
+Game::EnemyState Game::roll_state(float roll) const {
+	float total = 0.0f;
+	for (float weight : scenario.state_weights) total += weight;
+	roll *= total;
+	EnemyState last = chase;
+	for (uint32_t s = 0; s < 6; ++s) {
+		if (scenario.state_weights[s] <= 0.0f) continue;
+		if (roll < scenario.state_weights[s]) return EnemyState(s);
+		roll -= scenario.state_weights[s];
+		last = EnemyState(s);
 	}
+	return last; //(roll was at the very top of the range)
+}
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-	};
-	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
-
-	{ //load mesh data from a binary blob:
-		std::ifstream blob(data_path("meshes.blob"), std::ios::binary);
-		//The blob will be made up of three chunks:
-		// the first chunk will be vertex data (interleaved position/normal/color)
-		// the second chunk will be characters
-		// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
-
-		//read vertex data:
-		std::vector< Vertex > vertices;
-		read_chunk(blob, "dat0", &vertices);
-
-		//read character data (for names):
-		std::vector< char > names;
-		read_chunk(blob, "str0", &names);
-
-		//read index:
-		struct IndexEntry {
-			uint32_t name_begin;
-			uint32_t name_end;
-			uint32_t vertex_begin;
-			uint32_t vertex_end;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
-
-		std::vector< IndexEntry > index_entries;
-		read_chunk(blob, "idx0", &index_entries);
-
-		if (blob.peek() != EOF) {
-			std::cerr << "WARNING: trailing data in meshes file." << std::endl;
-		}
-
-		//upload vertex data to the graphics card:
-		glGenBuffers(1, &meshes_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//create map to store index entries:
-		std::map< std::string, Mesh > index;
-		for (IndexEntry const &e : index_entries) {
-			if (e.name_begin > e.name_end || e.name_end > names.size()) {
-				throw std::runtime_error("invalid name indices in index.");
-			}
-			if (e.vertex_begin > e.vertex_end || e.vertex_end > vertices.size()) {
-				throw std::runtime_error("invalid vertex indices in index.");
-			}
-			Mesh mesh;
-			mesh.first = e.vertex_begin;
-			mesh.count = e.vertex_end - e.vertex_begin;
-			auto ret = index.insert(std::make_pair(
-				std::string(names.begin() + e.name_begin, names.begin() + e.name_end),
-				mesh));
-			if (!ret.second) {
-				throw std::runtime_error("duplicate name in index.");
-			}
-		}
+World::Entity Game::spawn_scattered_enemy() {
+	glm::vec2 position = glm::vec2(-4.8f + 9.6f * scenario_rng.unit(), 0.3f + 9.2f * scenario_rng.unit());
+	float speed = 1.0f + 0.5f * scenario_rng.unit();
+	EnemyState state = roll_state(scenario_rng.unit());
+	float state_seconds = 7.0f + 13.0f * scenario_rng.unit(); //(keep the rolled state for a while)
+	return spawn_enemy(position, speed, state, state_seconds);
+}
 
-		//look up into index map to extract meshes:
-		auto lookup = [&index](std::string const &name) -> Mesh {
-			auto f = index.find(name);
-			if (f == index.end()) {
-				throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
-			}
-			return f->second;
-		};
-		//tile_mesh = lookup("Tile");
-		//cursor_mesh = lookup("Cursor");
-		player_mesh = lookup("Doll");
-		target_mesh = lookup("Egg.001");
-		enemy_mesh = lookup("Cube");
-		cursor_mesh = lookup("Aim");
-		golden_egg_mesh = lookup("Egg");
-	}
+World::Entity Game::spawn_target(bool golden) {
+	Pickup pickup;
+	pickup.points = 10;
+	pickup.golden = golden;
+	Position at;
+	at.value.y = rng.range(1.0f, 9.0f);
+	at.value.x = rng.range(-4.5f, 4.5f);
+	Body body;
+	body.radius = 0.8f;
+	Renderable renderable;
+	renderable.mesh = golden ? golden_egg_mesh : target_mesh;
+	renderable.z = -0.7f;
+	renderable.scale = glm::vec2(2.0f, 2.0f);
+	return world.create(pickup, at, body, renderable);
+}
 
-	{ //create vertex array object to hold the map from the mesh vertex buffer to shader program attributes:
-		glGenVertexArrays(1, &meshes_for_simple_shading_vao);
-		glBindVertexArray(meshes_for_simple_shading_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
-		glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
-		glEnableVertexAttribArray(simple_shading.Position_vec4);
-		if (simple_shading.Normal_vec3 != -1U) {
-			glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
-			glEnableVertexAttribArray(simple_shading.Normal_vec3);
-		}
-		if (simple_shading.Color_vec4 != -1U) {
-			glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
-			glEnableVertexAttribArray(simple_shading.Color_vec4);
-		}
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+Game::Game(MeshBuffer const &meshes, Scenario const &_scenario) : frame_arena(64 * 1024), scenario(_scenario), rng(_scenario.seed, 1), scenario_rng(_scenario.seed, 0) {
+	{ //look up the meshes used by the game:
+		//tile_mesh = meshes.lookup("Tile");
+		//cursor_mesh = meshes.lookup("Cursor");
+		player_mesh = meshes.lookup("Doll");
+		target_mesh = meshes.lookup("Egg.001");
+		enemy_mesh = meshes.lookup("Cube");
+		cursor_mesh = meshes.lookup("Aim");
+		golden_egg_mesh = meshes.lookup("Egg");
 	}
 
-	GL_ERRORS();
-
 	//----------------
 	//set up game board with meshes and rolls:
 	//board_meshes.reserve(board_size.x * board_size.y);
 	//board_rotations.reserve(board_size.x * board_size.y);
 	std::mt19937 mt(0xbead1234);
 
+	//size long-lived containers up front, so that normal play doesn't grow them mid-frame:
+	world.reserve(256);
+	timers.reserve(512);
+	ai_due.reserve(256);
+	hud.instances.reserve(64);
+
 	reset_game();
 }
 
 void Game::reset_game() {
+	rounds += 1;
 
 	score = 0;
 	golden_score = 250;
@@ -248,43 +162,212 @@ void Game::reset_game() {
 	power = 0.0f;
 
 	golden_active = false;
-	golden_time = 0.0f;
-
-	player = Player();
-	player.mesh = player_mesh;
-	player.position = glm::vec2(0.0f, 0.0f);
-	player.velocity = glm::vec2(0.0f, 0.0f);
-
-	enemies.clear();
-	Enemy enemy = Enemy();
-	enemy.mesh = enemy_mesh;
-	enemy.position = glm::vec2(3.0f, 3.0f);
-	enemy.speed = 1.0f;
-	enemy.direction = glm::linearRand(0.0f, 360.0f);
-	enemies.push_back(enemy);
-	enemies_spawned = 1;
+	golden_until = 0;
+	golden_expired = false;
+
+	timers.clear();
+	clock_remainder = 0.0f;
+	ai_due.clear();
+
+	world.clear();
+	enemy_serial = 0;
+	player = spawn_player();
+
+	//the first enemy always starts in the same place; any others are scattered:
+	for (uint32_t i = 0; i < scenario.enemies; ++i) {
+		if (i == 0) spawn_enemy(glm::vec2(3.0f, 3.0f), 1.0f, chase, 0.0f);
+		else spawn_scattered_enemy();
+	}
+	enemies_spawned = scenario.enemies;
+	spawn_credit = 0.0f;
+	if (scenario.golden_period > 0.0f) {
+		Event event;
+		event.kind = Event::ScenarioGolden;
+		timers.schedule(uint64_t(scenario.golden_period * TicksPerSecond), event);
+	}
 
 	eggs = 0;
 	golden_eggs = 0;
 
-	targets.clear();
-	for (int i=0; i<NUM_TARGETS; i++) {
-		Target target = create_target(false);
-		targets.push_back(target);
+	for (uint32_t i = 0; i < scenario.targets; i++) {
+		spawn_target(false);
 	}
 }
 
 Game::~Game() {
-	glDeleteVertexArrays(1, &meshes_for_simple_shading_vao);
-	meshes_for_simple_shading_vao = -1U;
+}
 
-	glDeleteBuffers(1, &meshes_vbo);
-	meshes_vbo = -1U;
+//The game-wide state, gathered into one trivially copyable block for snapshots:
+static uint32_t const GameStateMagic = 0x74617473; //"stat"
+struct GameState {
+	uint32_t magic;
+	uint32_t bytes; //(catches snapshots from other builds)
+	World::Entity player;
+	Game::State game_state;
+	bool golden_active;
+	uint64_t golden_until;
+	bool golden_expired;
+	TimerWheel< Game::Event >::Handle golden_timer;
+	float clock_remainder;
+	uint32_t enemies_spawned;
+	uint32_t enemy_serial;
+	uint32_t rounds;
+	float angle, power;
+	int score, golden_score;
+	uint32_t eggs, golden_eggs;
+	decltype(Game::controls) controls;
+	uint32_t controls_ticks;
+	bool controls_ticks_known;
+	uint32_t launch_ticks;
+	bool launched;
+	uint32_t update_ticks;
+	float spawn_credit;
+	Random rng, scenario_rng;
+};
+
+//(gather and scatter the game-wide state:)
+static void get_state(Game const &game, GameState *_state) {
+	assert(_state);
+	GameState &state = *_state;
+	std::memset(static_cast< void * >(&state), 0, sizeof(state)); //(padding too, so unchanged state saves identically)
+	state.magic = GameStateMagic;
+	state.bytes = sizeof(GameState);
+	state.player = game.player;
+	state.game_state = game.game_state;
+	state.golden_active = game.golden_active;
+	state.golden_until = game.golden_until;
+	state.golden_expired = game.golden_expired;
+	state.golden_timer = game.golden_timer;
+	state.clock_remainder = game.clock_remainder;
+	state.enemies_spawned = game.enemies_spawned;
+	state.enemy_serial = game.enemy_serial;
+	state.rounds = game.rounds;
+	state.angle = game.angle;
+	state.power = game.power;
+	state.score = game.score;
+	state.golden_score = game.golden_score;
+	state.eggs = game.eggs;
+	state.golden_eggs = game.golden_eggs;
+	state.controls = game.controls;
+	state.controls_ticks = game.controls_ticks;
+	state.controls_ticks_known = game.controls_ticks_known;
+	state.launch_ticks = game.launch_ticks;
+	state.launched = game.launched;
+	state.update_ticks = game.update_ticks;
+	state.spawn_credit = game.spawn_credit;
+	state.rng = game.rng;
+	state.scenario_rng = game.scenario_rng;
+}
 
-	glDeleteProgram(simple_shading.program);
-	simple_shading.program = -1U;
+static void set_state(GameState const &state, Game *_game) {
+	assert(_game);
+	Game &game = *_game;
+	game.player = state.player;
+	game.game_state = state.game_state;
+	game.golden_active = state.golden_active;
+	game.golden_until = state.golden_until;
+	game.golden_expired = state.golden_expired;
+	game.golden_timer = state.golden_timer;
+	game.clock_remainder = state.clock_remainder;
+	game.enemies_spawned = state.enemies_spawned;
+	game.enemy_serial = state.enemy_serial;
+	game.rounds = state.rounds;
+	game.angle = state.angle;
+	game.power = state.power;
+	game.score = state.score;
+	game.golden_score = state.golden_score;
+	game.eggs = state.eggs;
+	game.golden_eggs = state.golden_eggs;
+	game.controls = state.controls;
+	game.controls_ticks = state.controls_ticks;
+	game.controls_ticks_known = state.controls_ticks_known;
+	game.launch_ticks = state.launch_ticks;
+	game.launched = state.launched;
+	game.update_ticks = state.update_ticks;
+	game.spawn_credit = state.spawn_credit;
+	game.rng = state.rng;
+	game.scenario_rng = state.scenario_rng;
+
+	//(copied draw caches may predate changes since; rebuild them all)
+	game.queries.renderables.each(game.world, [](World::Entity, Game::Renderable &renderable, Game::Position &) {
+		renderable.cache.dirty = true;
+	});
+}
 
-	GL_ERRORS();
+void Game::save_state(std::vector< uint8_t > *_to) const {
+	assert(_to);
+	GameState state;
+	get_state(*this, &state);
+	write_bytes(_to, &state, 1);
+	timers.save(_to);
+	uint32_t due = uint32_t(ai_due.size());
+	write_bytes(_to, &due, 1);
+	write_bytes(_to, ai_due.data(), ai_due.size());
+	world.save(_to);
+}
+
+void Game::load_state(std::vector< uint8_t > const &from) {
+	ByteReader in(from.data(), from.size());
+	GameState state;
+	in.read(&state, 1);
+	if (state.magic != GameStateMagic || state.bytes != sizeof(GameState)) {
+		throw std::runtime_error("Not a game state snapshot (or one from a different build).");
+	}
+	if (uint32_t(state.game_state) > uint32_t(dead)) {
+		throw std::runtime_error("Snapshot has an unknown game state.");
+	}
+	//(check the whole snapshot first, so a malformed one leaves this game as it was)
+	ByteReader ahead = in;
+	TimerWheel< Event >::check(&ahead);
+	uint32_t due;
+	ahead.read(&due, 1);
+	ahead.skip(size_t(due) * sizeof(World::Entity));
+	World::check(&ahead);
+
+	timers.load(&in);
+	in.read(&due, 1);
+	ai_due.resize(due);
+	in.read(ai_due.data(), ai_due.size());
+	world.load(&in);
+	//(the keys held now are still held, whatever was held at the save)
+	auto live = controls;
+	set_state(state, this);
+	controls = live;
+
+	//aim and charge pick up from the next key event or update rather than integrating the gap:
+	controls_ticks_known = false;
+	if (game_state == charging && !controls.power_up) {
+		game_state = aiming;
+		power = 0.0f;
+	} else if (game_state == aiming && controls.power_up) {
+		game_state = charging;
+	}
+}
+
+void Game::clone_state(Game const &from) {
+	GameState state;
+	get_state(from, &state);
+	timers = from.timers;
+	ai_due = from.ai_due;
+	world.copy_from(from.world);
+	set_state(state, this);
+}
+
+uint32_t Game::input_events(Input const &from, Input const &to, uint32_t ticks, SDL_Event *events) {
+	assert(events);
+	uint32_t count = 0;
+	auto key = [&](bool was, bool is, SDL_Scancode scancode) {
+		if (was == is) return;
+		SDL_Event &evt = events[count++];
+		std::memset(&evt, 0, sizeof(evt));
+		evt.type = (is ? SDL_KEYDOWN : SDL_KEYUP);
+		evt.key.timestamp = ticks;
+		evt.key.keysym.scancode = scancode;
+	};
+	key(from.left, to.left, SDL_SCANCODE_LEFT);
+	key(from.right, to.right, SDL_SCANCODE_RIGHT);
+	key(from.charge, to.charge, SDL_SCANCODE_SPACE);
+	return count;
 }
 
 bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
@@ -294,6 +377,9 @@ bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
 	}
 
 	if (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP) {
+		//bring aim/charge up to the moment of the key transition before applying it:
+		advance_controls(evt.key.timestamp);
+
 		if (evt.key.keysym.scancode == SDL_SCANCODE_LEFT) {
 			controls.angle_left = (evt.type == SDL_KEYDOWN);
 			return true;
@@ -304,6 +390,9 @@ bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
 			controls.power_up = true;
 			game_state = charging;
 			return true;
+		} else if (evt.key.keysym.scancode == SDL_SCANCODE_SPACE && evt.type == SDL_KEYUP && game_state != charging) {
+			controls.power_up = false; //(released without launching, e.g. held through a landing)
+			return true;
 		}
 	}
 
@@ -313,7 +402,9 @@ bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
 		
 		float velx = glm::cos(angle * PI / 180.0f) * power;
 		float vely = glm::sin(angle * PI / 180.0f) * power;
-		player.velocity = glm::vec2(velx, vely);
+		world.get< Velocity >(player)->value = glm::vec2(velx, vely);
+		launch_ticks = controls_ticks;
+		launched = true;
 		return true;
 	}
 	return false;
@@ -324,12 +415,22 @@ bool collision(glm::vec2 p1, glm::vec2 p2, float dist) {
 	return (dif.x * dif.x + dif.y * dif.y) <= dist * dist;
 }
 
-void Game::update(float elapsed) {
-	switch(game_state) {
-	case charging:
+void Game::advance_controls(uint32_t ticks) {
+	if (!controls_ticks_known) {
+		controls_ticks = ticks;
+		controls_ticks_known = true;
+		return;
+	}
+	//(ignore out-of-order timestamps; don't integrate across very long gaps)
+	if (int32_t(ticks - controls_ticks) <= 0) return;
+	float elapsed = glm::min((ticks - controls_ticks) / 1000.0f, 0.1f);
+	controls_ticks = ticks;
+
+	if (game_state == charging) {
 		// Add to power
 		power = glm::min(power + 10.0f * elapsed, 12.0f);
-	case aiming:
+	}
+	if (game_state == charging || game_state == aiming) {
 		// Update aiming
 		if (controls.angle_left) {
 			angle = glm::min(angle + 50.0f * elapsed, 160.0f);
@@ -337,287 +438,459 @@ void Game::update(float elapsed) {
 		if (controls.angle_right) {
 			angle = glm::max(angle - 50.0f * elapsed, 20.0f);
 		}
+	}
+}
 
-		// Update golden
-		golden_active = golden_time > 0.0f;
+void Game::update(float elapsed, uint32_t ticks) {
+	update_ticks = ticks;
+	switch(game_state) {
+	case charging:
+	case aiming:
+		// Update aiming and power (for the part of the frame after the last key transition)
+		advance_controls(ticks);
 		break;
-	case flying:
-		// Update player
-		player.position += player.velocity * elapsed;
-		player.velocity.y -= elapsed * 6.0f;
-		if (player.position.y <= 0) {
-			player.position.y = 0;
+	case flying: {
+		Position &position = *world.get< Position >(player);
+		Velocity &velocity = *world.get< Velocity >(player);
+
+		// Update player (if launched this frame, only for the time since launch)
+		float flight_elapsed = elapsed;
+		if (launched) {
+			flight_elapsed = glm::min(elapsed, int32_t(ticks - launch_ticks) > 0 ? (ticks - launch_ticks) / 1000.0f : 0.0f);
+			launched = false;
+		}
+		position.value += velocity.value * flight_elapsed;
+		velocity.value.y -= flight_elapsed * 6.0f;
+		position.moved = true;
+		if (position.value.y <= 0 && velocity.value.y <= 0) { //(not on the way up: a launch at the end of a frame hasn't moved yet)
+			position.value.y = 0;
 			game_state = aiming;
+			controls_ticks = ticks; //(aiming resumes now)
 			angle = 90;
 			power = 0;
-			player.velocity = glm::vec2(0.0f, 0.0f);
+			velocity.value = glm::vec2(0.0f, 0.0f);
 
-			while (targets.size() < NUM_TARGETS) {
-				Target target;
+			uint32_t targets = queries.pickups.count(world);
+			while (targets < scenario.targets) {
 				if (score > golden_score) {
-					target = create_target(true);
+					spawn_target(true);
 					golden_score += 290;
 				} else {
-					target = create_target(false);
+					spawn_target(false);
 				}
-				targets.push_back(target);
+				targets += 1;
 			}
 
-			if (score > enemies_spawned * 100) {
-				Enemy enemy = Enemy();
-				enemy.mesh = enemy_mesh;
-				if (enemies.size() > 0) {
-					enemy.position = enemies[enemies.size() - 1].position;
-				} else {
-					enemy.position = glm::vec2(-5.0f, 10.0f);
-				}
-				enemy.speed = 1.0f + enemies_spawned * 0.05f;
-				enemy.direction = glm::linearRand(0.0f, 360.0f);
-				enemies.push_back(enemy);
+			if (scenario.spawn_rate == 0.0f && int64_t(score) > int64_t(enemies_spawned) * 100) {
+				//new enemies come in where the newest one is (storage order doesn't follow spawn order once enemies are eaten):
+				glm::vec2 from = glm::vec2(-5.0f, 10.0f);
+				uint32_t newest = 0;
+				bool found = false;
+				queries.ai.each(world, [&](World::Entity, EnemyAI &enemy, Heading &, Position &at, Renderable &) {
+					if (found && enemy.serial < newest) return;
+					found = true;
+					newest = enemy.serial;
+					from = at.value;
+				});
+				spawn_enemy(from, 1.0f + enemies_spawned * 0.05f, chase, 0.0f);
 				enemies_spawned++;
 			}
+
+			//state changes held for the landing happen now:
+			if (golden_expired) end_golden();
+			else resume_ai();
 		}
-		if (player.position.x >= 5.0f) {
-			player.velocity.x = -glm::abs(player.velocity.x);
-			player.position.x = 5.0f - (player.position.x - 5.0f);
-		} else if (player.position.x <= -5.0f) {
-			player.velocity.x = glm::abs(player.velocity.x);
-			player.position.x = -5.0f - (player.position.x + 5.0f);
+		if (position.value.x >= 5.0f) {
+			velocity.value.x = -glm::abs(velocity.value.x);
+			position.value.x = 5.0f - (position.value.x - 5.0f);
+		} else if (position.value.x <= -5.0f) {
+			velocity.value.x = glm::abs(velocity.value.x);
+			position.value.x = -5.0f - (position.value.x + 5.0f);
 		}
+	} break;
 	default:
 		break;
 	}
 
-	golden_time = glm::max(0.0f, golden_time - elapsed);
-
-	// Check targets
-	for (size_t i = 0; i < targets.size(); i++) {
-		Target target = targets[i];
-		// Check for a collision
-		if (collision(target.position, player.position, target.radius + player.radius)) {
-			// COLLISION
-			score += target.points;
-			targets.erase(targets.begin() + i);
-			i--;
-
-			if (target.golden) {
-				golden_active = true;
-				golden_time += 7.5f;
-				golden_eggs++;
-			} else {
-				eggs++;
-			}
+	// Fire the timers that came due this frame
+	clock_remainder += elapsed * TicksPerSecond;
+	uint64_t whole = uint64_t(std::max(0.0f, clock_remainder));
+	clock_remainder -= float(whole);
+	timers.advance(timers.now + whole, [this](Event const &event) { fire(event); });
+
+	// Scenario events
+	if (scenario.spawn_rate > 0.0f) {
+		for (spawn_credit += scenario.spawn_rate * elapsed; spawn_credit >= 1.0f; spawn_credit -= 1.0f) {
+			spawn_scattered_enemy();
+			enemies_spawned++;
 		}
 	}
 
-	// Update enemies
-	for (size_t i = 0; i < enemies.size(); i++) {
-		glm::vec2 dir;
-		float angle;
+	update_pickups();
+	update_movement(elapsed);
+	update_ai(elapsed);
+	if (update_hazards() && !scenario.immune) {
+		reset_game();
+		return;
+	}
+	world.flush();
+}
 
-		Enemy &enemy = enemies[i];
-		if (golden_active) {
-			// Start fleeing, but switch states once golden runs out
-			enemy.state = flee;
-			enemy.target_time = 0.0f;
+void Game::update_pickups() {
+	glm::vec2 at = world.get< Position >(player)->value;
+	float radius = world.get< Body >(player)->radius;
+	queries.pickups.each(world, [&](World::Entity entity, Pickup &pickup, Body &body, Position &position) {
+		if (!collision(position.value, at, body.radius + radius)) return;
+		score += pickup.points;
+		world.destroy(entity);
+
+		if (pickup.golden) {
+			start_golden(7.5f);
+			golden_eggs++;
+		} else {
+			eggs++;
+		}
+	});
+	world.flush();
+}
+
+void Game::update_movement(float elapsed) {
+	queries.movement.each_chunk(world, [&](uint32_t count, World::Entity const *, Heading *headings, Position *positions) {
+		for (uint32_t i = 0; i < count; ++i) {
+			float angle = headings[i].direction * PI / 180.0f;
+			positions[i].value += glm::vec2(glm::cos(angle), glm::sin(angle)) * (headings[i].speed * elapsed);
+			positions[i].moved = true;
+		}
+	});
+	queries.confinement.each_chunk(world, [&](uint32_t count, World::Entity const *, Confined *confined, Position *positions) {
+		for (uint32_t i = 0; i < count; ++i) {
+			positions[i].value = glm::min(glm::max(positions[i].value, confined[i].min), confined[i].max);
 		}
+	});
+}
 
-		// Update enemy based on position
-		angle = enemy.direction * PI / 180.0f;
-		dir = glm::vec2(glm::cos(angle) * enemy.speed * elapsed, glm::sin(angle) * enemy.speed * elapsed);
-		enemy.position += dir;
+void Game::update_ai(float elapsed) {
+	glm::vec2 player_position = world.get< Position >(player)->value;
+	glm::vec2 player_velocity = world.get< Velocity >(player)->value;
+
+	queries.ai.each(world, [&](World::Entity, EnemyAI &enemy, Heading &heading, Position &position, Renderable &) {
+		glm::vec2 dir;
+		float angle;
 
 		switch(enemy.state) {
 		case chase:
 			// Update direction to player
-			dir = player.position - enemy.position;
+			dir = player_position - position.value;
 			angle = atan2(dir.y, dir.x) * 180.0f / PI;
-			angle = fmod(enemy.direction - angle, 360.0f);
+			angle = fmod(heading.direction - angle, 360.0f);
 			if (angle < 0.0f) {
 				angle += 360.0f;
 			}
 			if (angle < 180.0f) {
-				enemy.direction += glm::linearRand(-80.0f, -60.0f) * elapsed;
+				heading.direction += rng.range(-80.0f, -60.0f) * elapsed;
 			} else {
-				enemy.direction += glm::linearRand(60.0f, 80.0f) * elapsed;
+				heading.direction += rng.range(60.0f, 80.0f) * elapsed;
 			}
 
 			break;
 		case flee:
 			// Update direction away from player
-			dir = enemy.position - player.position;
+			dir = position.value - player_position;
 			angle = atan2(dir.y, dir.x) * 180.0f / PI;
-			angle = fmod(enemy.direction - angle, 360.0f);
+			angle = fmod(heading.direction - angle, 360.0f);
 			if (angle < 0.0f) {
 				angle += 360.0f;
 			}
 			if (angle < 180.0f) {
-				enemy.direction += glm::linearRand(-80.0f, -60.0f) * elapsed;
+				heading.direction += rng.range(-80.0f, -60.0f) * elapsed;
 			} else {
-				enemy.direction += glm::linearRand(60.0f, 80.0f) * elapsed;
+				heading.direction += rng.range(60.0f, 80.0f) * elapsed;
 			}
 			break;
 		case patrol:
-			// Swap direction periodically
-			enemy.time_traveled += elapsed;
-			if (enemy.time_traveled >= 3.0f) {
-				enemy.time_traveled = 0.0f;
-				enemy.direction = 180.0f + enemy.direction;
-			}
+			// Swap direction periodically (see Event::PatrolTurn)
 			break;
 		case wander:
 			// Pick direction somewhat randomly, weighted towards center
-			dir = glm::vec2(0.0f, 5.0f) - enemy.position;
+			dir = glm::vec2(0.0f, 5.0f) - position.value;
 			angle = atan2(dir.y, dir.x) * 180.0f / PI;
 
 			// Get difference 
-			angle = fmod(enemy.direction - angle, 360.0f);
+			angle = fmod(heading.direction - angle, 360.0f);
 			if (angle < 0.0f) {
 				angle += 360.0f;
 			}
 			if (angle < 180.0f) {
-				enemy.direction += glm::linearRand(-60.0f, 20.0f) * elapsed;
+				heading.direction += rng.range(-60.0f, 20.0f) * elapsed;
 			} else {
-				enemy.direction += glm::linearRand(-20.0f, 60.0f) * elapsed;
+				heading.direction += rng.range(-20.0f, 60.0f) * elapsed;
 			}
 			break;
 		case circle:
 			// Go in circle
-			enemy.direction += 60.0f * elapsed;
+			heading.direction += 60.0f * elapsed;
 			break;
 		case hunt:
 			// Grab target ahead of player
-			auto target = player.position + player.velocity * 1.0f;
+			auto target = player_position + player_velocity * 1.0f;
 			
-			dir = target - enemy.position;
+			dir = target - position.value;
 			angle = atan2(dir.y, dir.x) * 180.0f / PI;
-			angle = fmod(enemy.direction - angle, 360.0f);
+			angle = fmod(heading.direction - angle, 360.0f);
 			if (angle < 0.0f) {
 				angle += 360.0f;
 			}
 			if (angle < 180.0f) {
-				enemy.direction += glm::linearRand(-80.0f, -60.0f) * elapsed;
+				heading.direction += rng.range(-80.0f, -60.0f) * elapsed;
 			} else {
-				enemy.direction += glm::linearRand(60.0f, 80.0f) * elapsed;
+				heading.direction += rng.range(60.0f, 80.0f) * elapsed;
 			}
 			break;
 		}
+	});
+}
+
+void Game::fire(Event const &event) {
+	switch(event.kind) {
+	case Event::EnemyStateChange:
+		if (!world.alive(event.entity)) break;
+		// Change AI (only when player is grounded)
+		if (game_state == flying || golden_active) {
+			ai_due.emplace_back(event.entity);
+		} else {
+			reroll(event.entity);
+		}
+		break;
+	case Event::PatrolTurn: {
+		EnemyAI *enemy = world.get< EnemyAI >(event.entity);
+		if (!enemy || enemy->state != patrol) break;
+		world.get< Heading >(event.entity)->direction += 180.0f;
+		enemy->patrol_timer = timers.schedule(timers.now + 3 * TicksPerSecond, event);
+	} break;
+	case Event::GoldenEnd:
+		if (game_state == flying) {
+			golden_expired = true; //(golden mode lasts until the landing)
+		} else {
+			end_golden();
+		}
+		break;
+	case Event::ScenarioGolden:
+		start_golden(scenario.golden_duration);
+		timers.schedule(timers.now + uint64_t(scenario.golden_period * TicksPerSecond), event);
+		break;
+	}
+}
 
-		// Make sure within bounds
-		enemy.position.x = glm::min(glm::max(enemy.position.x, -4.8f), 4.8f);
-		enemy.position.y = glm::min(glm::max(enemy.position.y, 0.3f), 9.5f);
+void Game::reroll(World::Entity entity) {
+	EnemyAI &enemy = *world.get< EnemyAI >(entity);
+	Heading &heading = *world.get< Heading >(entity);
+	Renderable &renderable = *world.get< Renderable >(entity);
+	timers.cancel(enemy.state_timer);
+	timers.cancel(enemy.patrol_timer);
+
+	enemy.state = roll_state(rng.range(0.0f, 1.0f));
+	Event event;
+	event.kind = Event::EnemyStateChange;
+	event.entity = entity;
+	enemy.state_timer = timers.schedule(timers.now + uint64_t(rng.range(7.0f, 20.0f) * TicksPerSecond), event);
+
+	// Some initialization
+	switch(enemy.state) {
+	case patrol:
+		event.kind = Event::PatrolTurn;
+		enemy.patrol_timer = timers.schedule(timers.now + 3 * TicksPerSecond, event);
+	case circle:
+	case wander:
+		heading.direction = rng.range(0.0f, 360.0f);
+		break;
+	default:
+		break;
+	}
 
-		// Check for a collision
-		if (collision(enemy.position, player.position, enemy.radius + player.radius + (golden_active ? 0.5f : 0.0f))) {
-			if (golden_active) {
-				enemies.erase(enemies.begin() + i);
-				i--;
-				continue;
-			} else {
-				reset_game();
-				return;
-			}
+	Facing facing = enemy_facing(enemy.state, golden_active);
+	if (renderable.facing != facing) {
+		renderable.facing = facing;
+		renderable.cache.dirty = true;
+	}
+}
+
+void Game::resume_ai() {
+	if (game_state == flying || golden_active) return;
+	for (World::Entity entity : ai_due) {
+		if (world.alive(entity)) reroll(entity);
+	}
+	ai_due.clear();
+}
+
+void Game::start_golden(float seconds) {
+	golden_until = std::max(golden_until, timers.now) + uint64_t(seconds * TicksPerSecond);
+	golden_expired = false;
+	timers.cancel(golden_timer);
+	Event event;
+	event.kind = Event::GoldenEnd;
+	golden_timer = timers.schedule(golden_until, event);
+	if (golden_active) return;
+
+	// Start fleeing, but switch states once golden runs out
+	golden_active = true;
+	ai_due.clear();
+	queries.ai.each(world, [&](World::Entity entity, EnemyAI &enemy, Heading &, Position &, Renderable &renderable) {
+		timers.cancel(enemy.state_timer);
+		timers.cancel(enemy.patrol_timer);
+		enemy.state = flee;
+		renderable.facing = FacingGolden;
+		renderable.cache.dirty = true;
+		ai_due.emplace_back(entity);
+	});
+}
+
+void Game::end_golden() {
+	golden_active = false;
+	golden_expired = false;
+	queries.ai.each(world, [&](World::Entity, EnemyAI &enemy, Heading &, Position &, Renderable &renderable) {
+		renderable.facing = enemy_facing(enemy.state, false);
+		renderable.cache.dirty = true;
+	});
+	resume_ai();
+}
+
+bool Game::update_hazards() {
+	glm::vec2 at = world.get< Position >(player)->value;
+	float radius = world.get< Body >(player)->radius + (golden_active ? 0.5f : 0.0f);
+	bool caught = false;
+	queries.hazards.each(world, [&](World::Entity entity, Hazard &, Body &body, Position &position) {
+		if (caught || !collision(position.value, at, body.radius + radius)) return;
+		if (golden_active) {
+			world.destroy(entity);
+		} else {
+			caught = true;
 		}
+	});
+	return caught;
+}
 
-		// Change AI (only when player is grounded)
-		enemy.state_time += elapsed;
-		if (enemy.state_time > enemy.target_time && game_state != flying && !golden_active) {
-			int state_roll = glm::linearRand(0, 10);
-			if (state_roll <= 2) {
-				enemy.state = chase;
-			} else if (state_roll == 3) {
-				enemy.state = flee;
-			} else if (state_roll <= 6) {
-				enemy.state = patrol;
-			} else if (state_roll <= 8) {
-				enemy.state = wander;
-			} else if (state_roll == 9) {
-				enemy.state = circle;
-			} else {
-				enemy.state = hunt;
+// Some helpers for common transforms
+Scaling scale_mat(float const scalex, float const scaley) {
+	return Scaling(scalex, scaley, 1.0f);
+}
+
+Translation trans_mat(float const transx, float const transy, float const transz) {
+	return Translation(transx, transy, transz);
+}
+
+// Enemy orientations by AI state
+constexpr Affine face1 = fixed_rotation< XAxis, -90 >;
+constexpr Affine face2 = fixed_rotation< XAxis, 90 >;
+constexpr Affine face3 = fixed_rotation< YAxis, 90 >;
+constexpr Affine face4 = fixed_rotation< YAxis, -90 >;
+
+// ...indexed by Game::Facing
+constexpr Affine orientations[] = { Affine(), face1, face2, face3, face4 };
+
+// Aim cursor rotations, every quarter degree over the aim range [20, 160]
+constexpr uint32_t CursorSteps = (160 - 20) * 4 + 1;
+struct CursorTable {
+	float sin[CursorSteps];
+	float cos[CursorSteps];
+};
+
+constexpr CursorTable make_cursor_table() {
+	CursorTable table = {};
+	for (uint32_t i = 0; i < CursorSteps; ++i) {
+		table.sin[i] = float(sin_degrees(20.0 + i * 0.25));
+		table.cos[i] = float(cos_degrees(20.0 + i * 0.25));
+	}
+	return table;
+}
+
+constexpr CursorTable cursor_table = make_cursor_table();
+
+Affine cursor_rotation(float const angle) {
+	uint32_t step = uint32_t(glm::clamp((angle - 20.0f) * 4.0f + 0.5f, 0.0f, float(CursorSteps - 1)));
+	float s = cursor_table.sin[step];
+	float c = cursor_table.cos[step];
+	//rotation by (180 - angle) with x and y swapped:
+	return Affine(s, -c, 0.0f, -c, -s, 0.0f, 0.0f, 0.0f, 1.0f, true);
+}
+
+void Game::update_hud(glm::uvec2 drawable_size, glm::vec2 view_min, glm::vec2 view_max) {
+	if (hud.eggs == eggs && hud.golden_eggs == golden_eggs && hud.drawable_size == drawable_size) return;
+	hud.eggs = eggs;
+	hud.golden_eggs = golden_eggs;
+	hud.drawable_size = drawable_size;
+
+	float aspect = float(drawable_size.x) / float(drawable_size.y);
+
+	float minX;
+	float maxX;
+	float ypos;
+
+	if (aspect > 1.0f) {
+		float extra = (aspect - 1.0f) * 5.0f;
+		if (extra < 1.0f) {
+			// Can't really render on screen, render off screen (culled below)
+			minX = -1000.0f;
+		} else {
+			minX = -(4.6f + extra);
+		}
+		maxX = -5.3f;
+		ypos = 9.0f;
+	} else {
+		minX = -4.6f;
+		maxX = 5.0f;
+		ypos = -1.2f;
+	}
+	float xpos = minX;
+
+	hud.instances.clear();
+	hud.culled_count = 0;
+
+	//lay out 'count' eggs at 'scale' with 'spacing', keeping only those that overlap the view:
+	auto lay_out = [&](uint32_t count, float scale, float spacing) {
+		for (; count > 0; --count) {
+			if (xpos >= maxX - spacing / 2.0f) {
+				xpos = minX;
+				ypos -= 1.0f;
 			}
-			enemy.state_time = 0.0f;
-			enemy.target_time = glm::linearRand(7.0f, 20.0f);
-
-			// Some initialization
-			switch(enemy.state) {
-			case patrol:
-				enemy.time_traveled = 0.0f;
-			case circle:
-			case wander:
-				enemy.direction = glm::linearRand(0.0f, 360.0f);
-				break;
-			default:
-				break;
+			//(spacing is a generous stand-in for the egg's extent)
+			if (xpos + spacing >= view_min.x && xpos - spacing <= view_max.x
+			 && ypos + spacing >= view_min.y && ypos - spacing <= view_max.y) {
+				hud.instances.emplace_back(xpos, ypos, -1.0f, scale);
+			} else {
+				hud.culled_count += 1;
 			}
+			xpos += spacing;
 		}
-	}
+	};
+
+	lay_out(eggs / 5, 1.5f, 0.8f);
+	lay_out(eggs % 5, 0.75f, 0.5f);
+	hud.egg_count = uint32_t(hud.instances.size());
+
+	lay_out(golden_eggs / 5, 1.5f, 0.8f);
+	lay_out(golden_eggs % 5, 0.75f, 0.5f);
+
+	hud.version += 1;
 }
 
-// Some helpers for common matrices
-glm::mat4 rot_mat(float const angle) {
-	float sintheta = glm::sin(angle * PI / 180.0f);
-	float costheta = glm::cos(angle * PI / 180.0f);
-	return glm::mat4(
-		sintheta, costheta, 0.0f, 0.0f,
-		costheta, -sintheta, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-	);
-}
-
-glm::mat4 scale_mat(float const scalex, float const scaley) {
-	return glm::mat4(
-		scalex, 0.0f, 0.0f, 0.0f,
-		0.0f, scaley, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-	);
-}
-
-glm::mat4 trans_mat(float const transx, float const transy, float const transz) {
-	return glm::mat4(
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		transx, transy, transz, 1.0f
-	);
-}
-
-glm::mat4 face1 = glm::mat4(
-	1.0f, 0.0f, 0.0f, 0.0f,
-	0.0f, glm::cos(PI / 2.0f), -glm::sin(PI / 2.0f), 0.0f,
-	0.0f, glm::sin(PI / 2.0f), glm::cos(PI / 2.0f), 0.0f,
-	0.0f, 0.0f, 0.0f, 1.0f
-);
-
-glm::mat4 face2 = glm::mat4(
-	1.0f, 0.0f, 0.0f, 0.0f,
-	0.0f, glm::cos(-PI / 2.0f), -glm::sin(-PI / 2.0f), 0.0f,
-	0.0f, glm::sin(-PI / 2.0f), glm::cos(-PI / 2.0f), 0.0f,
-	0.0f, 0.0f, 0.0f, 1.0f
-);
-
-glm::mat4 face3 = glm::mat4(
-	glm::cos(-PI / 2.0f), 0.0f, glm::sin(-PI / 2.0f), 0.0f,
-	0.0f, 1.0f, 0.0f, 0.0f,
-	-glm::sin(-PI / 2.0f), 0.0f, glm::cos(-PI / 2.0f), 0.0f,
-	0.0f, 0.0f, 0.0f, 1.0f
-);
-
-glm::mat4 face4 = glm::mat4(
-	glm::cos(PI / 2.0f), 0.0f, glm::sin(PI / 2.0f), 0.0f,
-	0.0f, 1.0f, 0.0f, 0.0f,
-	-glm::sin(PI / 2.0f), 0.0f, glm::cos(PI / 2.0f), 0.0f,
-	0.0f, 0.0f, 0.0f, 1.0f
-);
-
-void Game::draw(glm::uvec2 drawable_size) {
-	float aspect = float(drawable_size.x) / float(drawable_size.y);
+//meshes with any translucent vertices get drawn (blended) after everything else:
+static DrawPass mesh_pass(Game::Mesh const &mesh) {
+	return mesh.translucent ? TranslucentPass : OpaquePass;
+}
+
+void Game::draw(glm::uvec2 drawable_size, DrawList *_draw_list) {
+	assert(_draw_list);
+	DrawList &draw_list = *_draw_list;
 
-	//Set up a transformation matrix to fit the board in the window:
-	glm::mat4 world_to_clip;
-	{
+	draw_list.drawable_size = drawable_size;
+	draw_list.culled = 0;
+
+	//Set up a transformation matrix to fit the board in the window (only when its size changes):
+	if (view.drawable_size != drawable_size) {
+		view.drawable_size = drawable_size;
+		view.version += 1;
+
+		float aspect = float(drawable_size.x) / float(drawable_size.y);
 
 		//want scale such that board * scale fits in [-aspect,aspect]x[-1.0,1.0] screen box:
 		float scale = 0.2f;/*glm::min(
@@ -637,8 +910,12 @@ void Game::draw(glm::uvec2 drawable_size) {
 		}
 		glm::vec2 center = glm::vec2(0.0f, centerY);//0.5f * glm::vec2(board_size);
 
+		//world-space rectangle that maps to the viewport:
+		view.min = center - glm::vec2(aspect / scale, 1.0f / scale);
+		view.max = center + glm::vec2(aspect / scale, 1.0f / scale);
+
 		//NOTE: glm matrices are specified in column-major order
-		world_to_clip = glm::mat4(
+		view.world_to_clip = glm::mat4(
 			scale / aspect, 0.0f, 0.0f, 0.0f,
 			0.0f, scale, 0.0f, 0.0f,
 			0.0f, 0.0f,-1.0f, 0.0f,
@@ -646,195 +923,135 @@ void Game::draw(glm::uvec2 drawable_size) {
 		);
 	}
 
-	//set up graphics pipeline to use data from the meshes and the simple shading program:
-	glBindVertexArray(meshes_for_simple_shading_vao);
-	glUseProgram(simple_shading.program);
-
-	glUniform3fv(simple_shading.sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(simple_shading.sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(simple_shading.sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(simple_shading.sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-
-	//helper function to draw a given mesh with a given transformation:
-	auto draw_mesh = [&](Mesh const &mesh, glm::mat4 const &object_to_world) {
-		//set up the matrix uniforms:
-		if (simple_shading.object_to_clip_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
-			glUniformMatrix4fv(simple_shading.object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
-		if (simple_shading.object_to_light_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(simple_shading.object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_world));
-		}
-		if (simple_shading.normal_to_light_mat3 != -1U) {
-			//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
-			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
-			glUniformMatrix3fv(simple_shading.normal_to_light_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_world));
+	glm::mat4 const &world_to_clip = view.world_to_clip;
+	glm::vec2 const &view_min = view.min;
+	glm::vec2 const &view_max = view.max;
+
+	draw_list.world_to_clip = world_to_clip;
+	draw_list.view_min = view_min;
+	draw_list.view_max = view_max;
+
+	//dynamic objects are queued here (along with their world-space bounding spheres)
+	// and only emitted to the draw list if they survive culling:
+	frame_arena.reset();
+	size_t queued_max = queries.renderables.count(world) + 1; //(+ the cursor)
+	FrameVector< DrawPacket > dynamic_draws(&frame_arena);
+	dynamic_draws.reserve(queued_max);
+	FrameVector< float > cull_x(&frame_arena), cull_y(&frame_arena), cull_z(&frame_arena), cull_radius(&frame_arena);
+	cull_x.reserve(queued_max);
+	cull_y.reserve(queued_max);
+	cull_z.reserve(queued_max);
+	cull_radius.reserve(queued_max);
+
+	//rebuild an entity's cached transform and bounding sphere:
+	auto refresh = [&](Mesh const &mesh, Affine const &object_to_world, DrawCache *_cache) {
+		DrawCache &cache = *_cache;
+		cache.dirty = false;
+		cache.view_version = -1U;
+		cache.object_to_world = object_to_world;
+		cache.center = object_to_world.transform_point(mesh.center);
+		//radius grows by the largest axis scale:
+		cache.radius = mesh.radius * object_to_world.max_scale();
+	};
+	auto queue_mesh = [&](Mesh const &mesh, DrawCache *_cache) {
+		DrawCache &cache = *_cache;
+		assert(!cache.dirty);
+		if (cache.view_version != view.version) {
+			cache.view_version = view.version;
+			cache.key = make_sort_key(mesh_pass(mesh), uint32_t(mesh.first), (world_to_clip * glm::vec4(cache.center, 1.0f)).z);
 		}
 
-		//draw the mesh:
-		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+		DrawPacket packet;
+		packet.key = cache.key;
+		packet.first = mesh.first;
+		packet.count = mesh.count;
+		packet.object_to_world = cache.object_to_world;
+		dynamic_draws.emplace_back(packet);
+
+		cull_x.emplace_back(cache.center.x);
+		cull_y.emplace_back(cache.center.y);
+		cull_z.emplace_back(cache.center.z);
+		cull_radius.emplace_back(cache.radius);
 	};
 
-	draw_mesh(player.mesh, trans_mat(player.position.x, player.position.y, -0.5f));
-
-	// Draw enemies
-	for (Enemy enemy : enemies) {
-		auto mat = trans_mat(enemy.position.x, enemy.position.y, -0.5f);
-		if (golden_active) {
-			mat = mat * face2;
-		} else {
-			switch(enemy.state) {
-				case chase:
-				case hunt:
-					mat = mat * face1;
-					break;
-				case patrol:
-				case circle:
-					mat = mat * face4;
-					break;
-				case wander:
-				case flee:
-					mat = mat * face3;
-					break;
-			}
+	// Draw every renderable entity (player, enemies, targets)
+	queries.renderables.each(world, [&](World::Entity, Renderable &renderable, Position &position) {
+		if (position.moved || renderable.cache.dirty) {
+			position.moved = false;
+			refresh(renderable.mesh, trans_mat(position.value.x, position.value.y, renderable.z) * orientations[renderable.facing] * scale_mat(renderable.scale.x, renderable.scale.y), &renderable.cache);
 		}
-		draw_mesh(enemy.mesh, mat);
-	}
-
-	// Draw targets
-	for (Target target : targets) {
-
-		//std::cout << "Drawing" << target.position.x << target.position.y << std::endl;
-		draw_mesh(target.mesh, trans_mat(target.position.x, target.position.y, -0.7f) * scale_mat(2.0f, 2.0f));
-	}
-
-	glm::mat4 aimmat = rot_mat(180.0f - angle);
-
-	if (game_state == aiming) {
-		draw_mesh(cursor_mesh, trans_mat(player.position.x, player.position.y, -1.5f) * aimmat * scale_mat(0.1f, 2.3f) * trans_mat(0.0f, -1.0f, 0.0f));
-	}
-
-	if (game_state == charging) {
-		draw_mesh(cursor_mesh, trans_mat(player.position.x, player.position.y, -1.5f) * aimmat * scale_mat(0.1f, power / 6.0f) * trans_mat(0.0f, -1.0f, 0.0f) * face1);
-	}
-
-	
-	{ // Draw eggs gathered
-		uint32_t egg5 = eggs / 5;
-		uint32_t egg1 = eggs % 5;
-		uint32_t gegg5 = golden_eggs / 5;
-		uint32_t gegg1 = golden_eggs % 5;
-
-		float minX;
-		float maxX;
-		float ypos;
-
-		if (aspect > 1.0f) {
-			float extra = (aspect - 1.0f) * 5.0f;
-			if (extra < 1.0f) {
-				// Can't really render on screen, render off screen
-				minX = -1000.0f;
-			} else {
-				minX = -(4.6f + extra);
-			}
-			maxX = -5.3f;
-			ypos = 9.0f;
+		queue_mesh(renderable.mesh, &renderable.cache);
+	});
+
+	// The cursor changes with nearly every input, so it is rebuilt each frame
+	if (game_state == aiming || game_state == charging) {
+		glm::vec2 at = world.get< Position >(player)->value;
+		Affine aimmat = trans_mat(at.x, at.y, -1.5f) * cursor_rotation(angle);
+		if (game_state == aiming) {
+			refresh(cursor_mesh, aimmat * scale_mat(0.1f, 2.3f) * trans_mat(0.0f, -1.0f, 0.0f), &cursor_draw_cache);
 		} else {
-			minX = -4.6f;
-			maxX = 5.0f;
-			ypos = -1.2f;
-		}
-		float xpos = minX;
-
-		while(egg5 > 0) {
-
-			if (xpos >= maxX - 0.4f) {
-				xpos = minX;
-				ypos -= 1.0f;
-			}
-
-			// Draw egg
-			draw_mesh(target_mesh, trans_mat(xpos, ypos, -1.0f) * scale_mat(1.5f, 1.5f));
-
-			xpos += 0.8f;
-			egg5--;
+			refresh(cursor_mesh, aimmat * scale_mat(0.1f, power / 6.0f) * trans_mat(0.0f, -1.0f, 0.0f) * face1, &cursor_draw_cache);
 		}
+		queue_mesh(cursor_mesh, &cursor_draw_cache);
+	}
 
-		while(egg1 > 0) {
-			if (xpos >= maxX - 0.25f) {
-				xpos = minX;
-				ypos -= 1.0f;
-			}
-
-			// Draw egg
-			draw_mesh(target_mesh, trans_mat(xpos, ypos, -1.0f) * scale_mat(0.75f, 0.75f));
-
-			xpos += 0.5f;
-			egg1--;
-		}
+	{ // Cull queued objects against the view, then emit the survivors
+		size_t count = dynamic_draws.size();
+		FrameVector< uint8_t > visible_flags(count, 0, &frame_arena);
 
-		while(gegg5 > 0) {
+		size_t visible = frustum_cull(world_to_clip, count,
+			cull_x.data(), cull_y.data(), cull_z.data(), cull_radius.data(),
+			visible_flags.data());
+		draw_list.culled += uint32_t(count - visible);
 
-			if (xpos >= maxX - 0.4f) {
-				xpos = minX;
-				ypos -= 1.0f;
+		draw_list.packets.clear();
+		draw_list.packets.reserve(std::max< size_t >(visible, 128)); //(only allocates on first use or growth)
+		for (size_t i = 0; i < count; ++i) {
+			if (visible_flags[i]) {
+				draw_list.packets.emplace_back(dynamic_draws[i]);
 			}
-
-			// Draw egg
-			draw_mesh(golden_egg_mesh, trans_mat(xpos, ypos, -1.0f) * scale_mat(1.5f, 1.5f));
-
-			xpos += 0.8f;
-			gegg5--;
 		}
 
-		while(gegg1 > 0) {
-			if (xpos >= maxX - 0.25f) {
-				xpos = minX;
-				ypos -= 1.0f;
-			}
-
-			// Draw egg
-			draw_mesh(golden_egg_mesh, trans_mat(xpos, ypos, -1.0f) * scale_mat(0.75f, 0.75f));
+		draw_list.sort_packets();
+	}
 
-			xpos += 0.5f;
-			gegg1--;
+	{ // Eggs gathered
+		update_hud(drawable_size, view_min, view_max);
+
+		if (draw_list.hud_version != hud.version) {
+			draw_list.hud_version = hud.version;
+			draw_list.hud_instances.reserve(hud.instances.capacity());
+			draw_list.hud_instances = hud.instances;
+			draw_list.hud_egg_count = GLsizei(hud.egg_count);
+			draw_list.hud_egg_mesh.key = make_sort_key(mesh_pass(target_mesh), uint32_t(target_mesh.first), 0.0f);
+			draw_list.hud_egg_mesh.first = target_mesh.first;
+			draw_list.hud_egg_mesh.count = target_mesh.count;
+			draw_list.hud_golden_egg_mesh.key = make_sort_key(mesh_pass(golden_egg_mesh), uint32_t(golden_egg_mesh.first), 0.0f);
+			draw_list.hud_golden_egg_mesh.first = golden_egg_mesh.first;
+			draw_list.hud_golden_egg_mesh.count = golden_egg_mesh.count;
 		}
+		draw_list.culled += hud.culled_count;
 	}
-	
-
-	// Draw walls
-	draw_mesh(enemy_mesh, trans_mat(-5.3f, 5.0f, 0.0f) * scale_mat(1.0f, 100.0f));
-	draw_mesh(enemy_mesh, trans_mat(5.3f, 5.0f, 0.0f) * scale_mat(1.0f, 100.0f));
-
-	// Draw floor
-	draw_mesh(enemy_mesh, trans_mat(0.0f, -0.3f, 0.0f) * scale_mat(100.0f, 1.0f));
 
-	glUseProgram(0);
-
-	GL_ERRORS();
-}
-
-
-
-//create and return an OpenGL vertex shader from source:
-static GLuint compile_shader(GLenum type, std::string const &source) {
-	GLuint shader = glCreateShader(type);
-	GLchar const *str = source.c_str();
-	GLint length = GLint(source.size());
-	glShaderSource(shader, 1, &str, &length);
-	glCompileShader(shader);
-	GLint compile_status = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-	if (compile_status != GL_TRUE) {
-		std::cerr << "Failed to compile shader." << std::endl;
-		GLint info_log_length = 0;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
-		throw std::runtime_error("Failed to compile shader.");
+	{ // Walls and floor (static; the renderer bakes them when the version changes)
+		if (draw_list.scenery_version != 1) {
+			draw_list.scenery_version = 1;
+			draw_list.scenery.clear();
+			auto add_scenery = [&](Mesh const &mesh, Affine const &object_to_world) {
+				DrawPacket packet;
+				packet.key = make_sort_key(mesh_pass(mesh), uint32_t(mesh.first), 0.0f);
+				packet.first = mesh.first;
+				packet.count = mesh.count;
+				packet.object_to_world = object_to_world;
+				draw_list.scenery.emplace_back(packet);
+			};
+
+			// Walls
+			add_scenery(enemy_mesh, trans_mat(-5.3f, 5.0f, 0.0f) * scale_mat(1.0f, 100.0f));
+			add_scenery(enemy_mesh, trans_mat(5.3f, 5.0f, 0.0f) * scale_mat(1.0f, 100.0f));
+
+			// Floor
+			add_scenery(enemy_mesh, trans_mat(0.0f, -0.3f, 0.0f) * scale_mat(100.0f, 1.0f));
+		}
 	}
-	return shader;
 }
@@ -1,6 +1,12 @@
 #pragma once
 
-#include "GL.hpp"
+#include "MeshBuffer.hpp"
+#include "DrawList.hpp"
+#include "World.hpp"
+#include "FrameArena.hpp"
+#include "Scenario.hpp"
+#include "Random.hpp"
+#include "TimerWheel.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
@@ -12,9 +18,9 @@
 // and is called by the main loop.
 
 struct Game {
-	//Game creates OpenGL resources (i.e. vertex buffer objects) in its
-	//constructor and frees them in its destructor.
-	Game();
+	//Game looks up the meshes it uses in 'meshes' (it does not touch OpenGL;
+	// see Renderer for that); 'scenario' sets up each round:
+	Game(MeshBuffer const &meshes, Scenario const &scenario = Scenario());
 	~Game();
 
 	//handle_event is called when new mouse or keyboard events are received:
@@ -22,41 +28,50 @@ struct Game {
 	//The function should return 'true' if it handled the event.
 	bool handle_event(SDL_Event const &evt, glm::uvec2 window_size);
 
-	//update is called at the start of a new frame, after events are handled:
-	void update(float elapsed);
+	//update is called at the start of a new frame, after events are handled;
+	// 'ticks' is when (on the SDL_GetTicks() clock of event timestamps) the frame's input was sampled:
+	void update(float elapsed, uint32_t ticks);
 
-	//draw is called after update:
-	void draw(glm::uvec2 drawable_size);
+	//draw is called after update; it fills in (and overwrites) 'draw_list'
+	// with everything needed to render the current state:
+	void draw(glm::uvec2 drawable_size, DrawList *draw_list);
 
-	//------- opengl resources -------
+	//------- snapshots -------
 
-	//shader program that draws lit objects with vertex colors:
-	struct {
-		GLuint program = -1U; //program object
-
-		//uniform locations:
-		GLuint object_to_clip_mat4 = -1U;
-		GLuint object_to_light_mat4x3 = -1U;
-		GLuint normal_to_light_mat3 = -1U;
-		GLuint sun_direction_vec3 = -1U;
-		GLuint sun_color_vec3 = -1U;
-		GLuint sky_direction_vec3 = -1U;
-		GLuint sky_color_vec3 = -1U;
-
-		//attribute locations:
-		GLuint Position_vec4 = -1U;
-		GLuint Normal_vec3 = -1U;
-		GLuint Color_vec4 = -1U;
-	} simple_shading;
-
-	//mesh data, stored in a vertex buffer:
-	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
-
-	//The location of each mesh in the meshes vertex buffer:
-	struct Mesh {
-		GLint first = 0;
-		GLsizei count = 0;
+	//append the whole simulation state (entities, game-wide state, random generators)
+	// to '_to' as raw bytes (see SnapshotRing for keeping many of them cheaply):
+	void save_state(std::vector< uint8_t > *_to) const;
+	//return to a save_state() made by this program (with the same scenario), in time
+	// proportional to its size; throws if malformed (leaving the game as it was).
+	//The live key state is kept (charging follows whether space is held now):
+	void load_state(std::vector< uint8_t > const &from);
+
+	//make this game's simulation a copy of 'from's (a Game with the same scenario);
+	// storage is reused, so once this game has held as many entities it doesn't allocate:
+	void clone_state(Game const &from);
+
+	//------- lookahead -------
+
+	//the keys a bot holds down:
+	struct Input {
+		bool left = false;
+		bool right = false;
+		bool charge = false;
 	};
+	//write the key events that change 'from' into 'to' at 'ticks' to 'events' (room for
+	// three); returns how many there are:
+	static uint32_t input_events(Input const &from, Input const &to, uint32_t ticks, SDL_Event *events);
+
+	//run the simulation 'seconds' ahead in fixed steps (with no drawing), holding the keys
+	// that 'policy(Game const &)' returns before each step; used on clones (see clone_state)
+	// by bots that plan by trying things out:
+	template< typename Policy >
+	void simulate_for(float seconds, Policy &&policy, float step = 1.0f / 60.0f);
+
+	//------- meshes -------
+
+	//The location of each mesh in the mesh buffer:
+	typedef MeshBuffer::Mesh Mesh;
 
 	Mesh enemy_mesh;
 	Mesh player_mesh;
@@ -64,7 +79,49 @@ struct Game {
 	Mesh golden_egg_mesh;
 	Mesh cursor_mesh;
 
-	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo to the simple_shading_program
+	//------- HUD -------
+
+	//The egg tally is laid out only when the counts or drawable size change
+	// (the renderer re-uploads it only when hud.version changes):
+	struct {
+		uint32_t eggs = -1U;
+		uint32_t golden_eggs = -1U;
+		glm::uvec2 drawable_size = glm::uvec2(0);
+		uint32_t version = 0;
+
+		std::vector< glm::vec4 > instances; //xyz offset + xy scale; eggs first, then golden eggs
+		uint32_t egg_count = 0;
+		uint32_t culled_count = 0; //eggs dropped because they fall outside the view
+	} hud;
+
+	//re-lay out the egg tally (if needed) for the visible world rectangle [view_min,view_max]:
+	void update_hud(glm::uvec2 drawable_size, glm::vec2 view_min, glm::vec2 view_max);
+
+	//------- per-frame drawing -------
+
+	//The view only depends on the drawable size, so it is rebuilt only when that changes:
+	struct {
+		glm::uvec2 drawable_size = glm::uvec2(0);
+		uint32_t version = 0; //incremented whenever world_to_clip changes
+		glm::mat4 world_to_clip = glm::mat4(1.0f);
+		glm::vec2 min = glm::vec2(0.0f), max = glm::vec2(0.0f); //world-space rectangle shown
+	} view;
+
+	//Each drawn entity caches its world-space draw data; draw() only rebuilds it when
+	// the entity has moved or the cache was marked dirty (e.g., on a change of facing):
+	struct DrawCache {
+		bool dirty = true;
+		uint32_t view_version = -1U; //(the sort key depends on world_to_clip)
+		Affine object_to_world;
+		glm::vec3 center = glm::vec3(0.0f); //world-space bounding sphere
+		float radius = 0.0f;
+		uint64_t key = 0;
+	};
+	DrawCache cursor_draw_cache;
+
+	//transient per-frame data (e.g., the dynamic objects queued for culling) lives
+	// here, and is recycled at the start of each draw():
+	FrameArena frame_arena;
 
 	//------- game state -------
 
@@ -76,50 +133,128 @@ struct Game {
 
 	void reset_game();
 
-	struct Player {
-		Mesh mesh = Mesh();
-		glm::vec2 position = glm::vec2(0.0f, 0.0f);
-		glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
-		float radius = 0.2f;
-	};
-
 	enum EnemyState {
 		chase = 0, flee = 1, patrol = 2, wander = 3, circle = 4, hunt = 5
 	};
 
-	struct Enemy {
-		Mesh mesh = Mesh();
-		glm::vec2 position = glm::vec2(0.0f, 0.0f);
-		float speed = 0.0f;
-		float radius = 0.2f;
+	//------- entities -------
 
+	//Everything on the board is an entity in 'world', made of components (below);
+	// each system handles every entity that has the components it needs, so new kinds
+	// of entity are made by combining components rather than by editing update().
 
-		// AI Control: some optional variables
+	struct Position {
+		glm::vec2 value = glm::vec2(0.0f);
+		bool moved = true; //set by whatever moves the entity; cleared when it is drawn
+	};
+	struct Velocity { //(the player's flight)
+		glm::vec2 value = glm::vec2(0.0f);
+	};
+	struct Heading { //walks at 'speed' toward 'direction' (degrees)
 		float direction = 0.0f;
-		float time_traveled = 0.0f;
+		float speed = 0.0f;
+	};
+	struct Confined { //kept inside [min,max]
+		glm::vec2 min = glm::vec2(0.0f), max = glm::vec2(0.0f);
+	};
+	struct Body { //collision circle
+		float radius = 0.0f;
+	};
+	struct Hazard { //catches the player (unless golden, when it gets eaten instead)
+	};
+	struct Pickup { //collected (and scored) on contact with the player
+		int points = 0;
+		bool golden = false;
+	};
+	//something scheduled on the timer wheel (see timers, below):
+	struct Event {
+		enum Kind : uint32_t {
+			EnemyStateChange, PatrolTurn, GoldenEnd, ScenarioGolden
+		} kind;
+		World::Entity entity; //(for enemy events)
+	};
+	struct EnemyAI {
 		EnemyState state = chase;
-
-		float state_time = 0.0f;
-		float target_time = 0.0f;
+		TimerWheel< Event >::Handle state_timer; //next change of state
+		TimerWheel< Event >::Handle patrol_timer; //next turn (when patrolling)
+		uint32_t serial = 0; //(spawn order this round; the newest is highest)
 	};
 
-	struct Target {
+	//fixed orientations (see orientations[] in Game.cpp):
+	enum Facing : uint8_t {
+		FacingNone = 0, FacingAggressive, FacingGolden, FacingMindless, FacingPatrol
+	};
+	struct Renderable {
 		Mesh mesh = Mesh();
-		glm::vec2 position = glm::vec2(0.0f, 0.0f);
-		int points = 0;
-		float radius = 0.8f;
-		bool golden = false;
+		float z = 0.0f;
+		glm::vec2 scale = glm::vec2(1.0f);
+		Facing facing = FacingNone;
+		DrawCache cache;
 	};
 
-	Target create_target(bool golden);
+	World world;
+	World::Entity player;
+
+	//cached queries, one per system:
+	struct {
+		World::Query< Heading, Position > movement;
+		World::Query< Confined, Position > confinement;
+		World::Query< EnemyAI, Heading, Position, Renderable > ai;
+		World::Query< Pickup, Body, Position > pickups;
+		World::Query< Hazard, Body, Position > hazards;
+		World::Query< Renderable, Position > renderables;
+	} queries;
+
+	World::Entity spawn_player();
+	World::Entity spawn_enemy(glm::vec2 position, float speed, EnemyState state, float state_seconds); //(keeps 'state' that long)
+	World::Entity spawn_target(bool golden);
+
+	//------- scenario -------
+
+	Scenario scenario;
+	Random rng; //the game's own randomness (AI steering, target placement)
+	Random scenario_rng; //(separate from 'rng', so setups are repeatable)
+	float spawn_credit = 0.0f; //fractional enemies owed by spawn_rate
+
+	EnemyState roll_state(float roll) const; //pick a state by scenario.state_weights; 'roll' in [0,1)
+	World::Entity spawn_scattered_enemy(); //random place, speed, and state (from scenario_rng)
+
+	//------- systems -------
+
+	void update_movement(float elapsed); //walk along headings, then stay confined
+	void update_ai(float elapsed); //steer enemies (state changes are timer events)
+	void update_pickups(); //collect and score pickups the player touches
+	bool update_hazards(); //returns 'true' if a hazard caught the player
+	//(rendering is done by draw())
+
+	//------- timers -------
+
+	//Things that happen after a while (an enemy's change of state, a patrol's turn, the
+	// end of golden mode) are scheduled on a timer wheel in ticks of simulated time, and
+	// cost nothing until the tick they come due (see Event, above):
+	static constexpr uint32_t TicksPerSecond = 1000;
+	TimerWheel< Event > timers;
+	float clock_remainder = 0.0f; //simulated seconds not yet advanced onto the wheel
+	void fire(Event const &event);
+
+	//enemies waiting to change state until the player lands and golden mode ends:
+	std::vector< World::Entity > ai_due;
+
+	void reroll(World::Entity enemy); //pick a new state (and how long to keep it)
+	void resume_ai(); //reroll everything in ai_due (if the player is grounded and not golden)
+
+	//------- game-wide state -------
 
 	bool golden_active = false;
-	float golden_time = 0.0f;
+	uint64_t golden_until = 0; //(tick)
+	bool golden_expired = false; //ran out mid-flight; ends on landing
+	TimerWheel< Event >::Handle golden_timer;
+	void start_golden(float seconds); //(or extend it)
+	void end_golden();
 
-	Player player;
-	std::vector< Enemy > enemies;
-	std::vector< Target > targets;
 	uint32_t enemies_spawned = 0;
+	uint32_t enemy_serial = 0; //(the next EnemyAI::serial)
+	uint32_t rounds = 0; //(reset_game() calls; a bot notices being caught by this changing)
 
 	float angle = 90.0f;
 	float power = 0.0f;
@@ -136,4 +271,35 @@ struct Game {
 		bool power_up = false;
 	} controls;
 
+	//Aim and charge are integrated from one key transition to the next at the events'
+	// own timestamps (not at frame boundaries), so launches don't depend on the frame rate:
+	uint32_t controls_ticks = 0; //time up to which angle and power have been integrated
+	bool controls_ticks_known = false;
+	void advance_controls(uint32_t ticks);
+	//...and a launch's first flight step starts at the release, not the frame start:
+	uint32_t launch_ticks = 0;
+	bool launched = false; //(launched since the last update)
+	uint32_t update_ticks = 0; //'ticks' at the latest update
+
 };
+
+template< typename Policy >
+void Game::simulate_for(float seconds, Policy &&policy, float step) {
+	Input held;
+	held.left = controls.angle_left;
+	held.right = controls.angle_right;
+	held.charge = controls.power_up;
+	uint32_t start = update_ticks;
+	uint32_t steps = uint32_t(seconds / step + 0.5f);
+	for (uint32_t s = 0; s < steps; ++s) {
+		uint32_t ticks = start + uint32_t(s * step * 1000.0f + 0.5f);
+		Input input = policy(static_cast< Game const & >(*this));
+		SDL_Event events[3];
+		uint32_t count = input_events(held, input, ticks, events);
+		for (uint32_t e = 0; e < count; ++e) {
+			handle_event(events[e], glm::uvec2(0));
+		}
+		held = input;
+		update(step, start + uint32_t((s + 1) * step * 1000.0f + 0.5f));
+	}
+}
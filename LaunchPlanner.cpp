@@ -0,0 +1,161 @@
+#include "LaunchPlanner.hpp"
+
+#include "worker_threads.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+LaunchPlanner::LaunchPlanner(MeshBuffer const &meshes, Scenario const &scenario, uint32_t workers) : source(new Game(meshes, scenario)), next_candidate(0) {
+	if (workers == 0) {
+		workers = default_worker_threads();
+	}
+	for (uint32_t i = 0; i < workers; ++i) {
+		clones.emplace_back(new Game(meshes, scenario));
+	}
+	for (uint32_t i = 0; i < workers; ++i) {
+		threads.emplace_back(&LaunchPlanner::work, this, i);
+	}
+}
+
+LaunchPlanner::~LaunchPlanner() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	plan_changed.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+Game::Input LaunchPlanner::Aim::operator()(Game const &game) const {
+	Game::Input input;
+	if (game.game_state != Game::aiming && game.game_state != Game::charging) return input;
+
+	//(turning is 50 degrees per second, so this is about a step at 60Hz)
+	float const Slack = 1.0f;
+	input.left = (game.angle < launch.angle - Slack);
+	input.right = (game.angle > launch.angle + Slack);
+	if (game.game_state == Game::charging) {
+		input.charge = (game.power < launch.power); //(letting go launches)
+	} else {
+		input.charge = !input.left && !input.right;
+	}
+	return input;
+}
+
+void LaunchPlanner::start(Game const &game, std::vector< Launch > const &_candidates, float _horizon) {
+	auto start = std::chrono::steady_clock::now();
+	wait(); //(the workers may still be reading 'source')
+
+	source->clone_state(game);
+	values.resize(_candidates.size());
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		candidates = &_candidates;
+		horizon = _horizon;
+		next_candidate = 0;
+		working = uint32_t(threads.size());
+		finished = false;
+		started = start;
+		generation += 1;
+	}
+	plan_changed.notify_all();
+
+	double ms = std::chrono::duration< double, std::milli >(std::chrono::steady_clock::now() - start).count();
+	start_ms_total += ms;
+	start_ms_max = std::max(start_ms_max, ms);
+}
+
+bool LaunchPlanner::busy() {
+	std::unique_lock< std::mutex > lock(mutex);
+	return working != 0;
+}
+
+void LaunchPlanner::wait() {
+	std::unique_lock< std::mutex > lock(mutex);
+	workers_done.wait(lock, [this](){ return working == 0; });
+}
+
+bool LaunchPlanner::poll(Launch *_best) {
+	assert(_best);
+	std::vector< Launch > const *done;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		if (!finished) return false;
+		finished = false;
+		done = candidates;
+	}
+
+	float best_value = -1e30f;
+	for (uint32_t c = 0; c < done->size(); ++c) {
+		if (values[c] > best_value) {
+			best_value = values[c];
+			*_best = (*done)[c];
+		}
+	}
+	return true;
+}
+
+LaunchPlanner::Launch LaunchPlanner::plan(Game const &game, std::vector< Launch > const &_candidates, float _horizon) {
+	start(game, _candidates, _horizon);
+	wait();
+	Launch best;
+	poll(&best);
+	return best;
+}
+
+std::vector< LaunchPlanner::Launch > LaunchPlanner::launch_grid(uint32_t angles, uint32_t powers) {
+	std::vector< Launch > grid;
+	grid.reserve(angles * powers);
+	for (uint32_t a = 0; a < angles; ++a) {
+		for (uint32_t p = 0; p < powers; ++p) {
+			Launch launch;
+			launch.angle = 20.0f + 140.0f * (a + 0.5f) / float(angles);
+			launch.power = 12.0f * (p + 1) / float(powers);
+			grid.emplace_back(launch);
+		}
+	}
+	return grid;
+}
+
+void LaunchPlanner::work(uint32_t worker) {
+	Game &clone = *clones[worker];
+	uint32_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			plan_changed.wait(lock, [&](){ return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		for (uint32_t c = next_candidate++; c < candidates->size(); c = next_candidate++) {
+			clone.clone_state(*source); //(workers only read 'source')
+			uint32_t rounds = clone.rounds;
+			int score = clone.score;
+
+			Aim aim;
+			aim.launch = (*candidates)[c];
+			clone.simulate_for(horizon, aim);
+
+			//points gained, unless caught (then the round ends); ties go to gentler launches:
+			if (clone.rounds != rounds) values[c] = -1000.0f;
+			else values[c] = float(clone.score - score) - 0.01f * aim.launch.power;
+		}
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			working -= 1;
+			if (working == 0) {
+				finished = true;
+				double ms = std::chrono::duration< double, std::milli >(std::chrono::steady_clock::now() - started).count();
+				plans += 1;
+				launches_tried += candidates->size();
+				plan_ms_total += ms;
+				plan_ms_max = std::max(plan_ms_max, ms);
+				workers_done.notify_all();
+			}
+		}
+	}
+}
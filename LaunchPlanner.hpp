@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Game.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//LaunchPlanner is a bot that plans by trying things out: given a game that is aiming,
+// it plays each candidate launch (angle, power) forward on a clone of the game (see
+// Game::clone_state and Game::simulate_for), spread over a pool of worker threads,
+// and returns the one that scores best. Aim then steers the real game to it.
+//Planning runs in the background, so the game keeps going meanwhile:
+//   planner.start(game, candidates, 3.0f); //(copies 'game', then returns)
+//   ... on later frames ...
+//   if (planner.poll(&aim.launch)) ...hold the keys aim(game) says (see Game::input_events)...
+//
+//The planner keeps its own copy of the game to plan from and each worker keeps its
+// own clone, so (once they have held as many entities as the game) planning doesn't
+// allocate.
+
+struct LaunchPlanner {
+	//the clones are made from 'meshes' and 'scenario' (which should match the game's):
+	LaunchPlanner(MeshBuffer const &meshes, Scenario const &scenario, uint32_t workers = 0); //0 workers = pick from core count
+	~LaunchPlanner();
+
+	struct Launch {
+		float angle = 90.0f; //degrees, in [20,160]
+		float power = 6.0f; //in (0,12]
+	};
+
+	//turn to the launch's angle, charge to its power, and let go:
+	struct Aim {
+		Launch launch;
+		Game::Input operator()(Game const &game) const;
+	};
+
+	//start playing each of 'candidates' 'horizon' seconds ahead from (a copy of) 'game';
+	// 'candidates' must stay alive until the plan is done (waits for any earlier plan):
+	void start(Game const &game, std::vector< Launch > const &candidates, float horizon);
+	bool busy(); //is a plan being worked on?
+	//if a plan has finished since the last poll(), write its best launch to '_best':
+	bool poll(Launch *_best);
+	void wait(); //(until the current plan, if any, is done)
+
+	//start(), wait(), and return the best:
+	Launch plan(Game const &game, std::vector< Launch > const &candidates, float horizon);
+
+	//a grid of candidates covering every angle and power:
+	static std::vector< Launch > launch_grid(uint32_t angles, uint32_t powers);
+
+	std::vector< float > values; //each candidate's value in the latest plan()
+
+	//counters:
+	uint64_t plans = 0;
+	uint64_t launches_tried = 0;
+	double plan_ms_total = 0.0; //(from start() until the workers are done)
+	double plan_ms_max = 0.0;
+	double start_ms_total = 0.0; //time spent in start() itself (on the caller's thread)
+	double start_ms_max = 0.0;
+
+private:
+	std::unique_ptr< Game > source; //the game as it was at start()
+	std::vector< std::unique_ptr< Game > > clones; //one per worker
+
+	//the plan being worked on:
+	std::vector< Launch > const *candidates = nullptr;
+	float horizon = 0.0f;
+	std::atomic< uint32_t > next_candidate;
+	std::chrono::steady_clock::time_point started;
+
+	std::mutex mutex;
+	std::condition_variable plan_changed;
+	std::condition_variable workers_done;
+	uint32_t generation = 0; //incremented for every plan()
+	uint32_t working = 0; //workers still on the current plan
+	bool finished = false; //a plan finished and hasn't been poll()'d yet
+	bool quit = false;
+	std::vector< std::thread > threads;
+
+	void work(uint32_t worker);
+};
@@ -0,0 +1,79 @@
+#include "MeshBuffer.hpp"
+
+#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+MeshBuffer::MeshBuffer(std::string const &filename) {
+	std::ifstream blob(filename, std::ios::binary);
+	//The blob will be made up of three chunks:
+	// the first chunk will be vertex data (interleaved position/normal/color)
+	// the second chunk will be characters
+	// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
+
+	//read vertex data:
+	read_chunk(blob, "dat0", &vertices);
+
+	//read character data (for names):
+	std::vector< char > names;
+	read_chunk(blob, "str0", &names);
+
+	//read index:
+	struct IndexEntry {
+		uint32_t name_begin;
+		uint32_t name_end;
+		uint32_t vertex_begin;
+		uint32_t vertex_end;
+	};
+	static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
+
+	std::vector< IndexEntry > index_entries;
+	read_chunk(blob, "idx0", &index_entries);
+
+	if (blob.peek() != EOF) {
+		std::cerr << "WARNING: trailing data in meshes file." << std::endl;
+	}
+
+	//store index entries in map:
+	for (IndexEntry const &e : index_entries) {
+		if (e.name_begin > e.name_end || e.name_end > names.size()) {
+			throw std::runtime_error("invalid name indices in index.");
+		}
+		if (e.vertex_begin > e.vertex_end || e.vertex_end > vertices.size()) {
+			throw std::runtime_error("invalid vertex indices in index.");
+		}
+		Mesh mesh;
+		mesh.first = e.vertex_begin;
+		mesh.count = e.vertex_end - e.vertex_begin;
+		if (mesh.count > 0) {
+			//bounding sphere around the center of the mesh's bounding box:
+			glm::vec3 min = vertices[e.vertex_begin].Position;
+			glm::vec3 max = min;
+			for (uint32_t v = e.vertex_begin; v < e.vertex_end; ++v) {
+				min = glm::min(min, vertices[v].Position);
+				max = glm::max(max, vertices[v].Position);
+			}
+			mesh.center = 0.5f * (min + max);
+			for (uint32_t v = e.vertex_begin; v < e.vertex_end; ++v) {
+				mesh.radius = glm::max(mesh.radius, glm::length(vertices[v].Position - mesh.center));
+				mesh.translucent = mesh.translucent || (vertices[v].Color.a < 255);
+			}
+		}
+		auto ret = index.insert(std::make_pair(
+			std::string(names.begin() + e.name_begin, names.begin() + e.name_end),
+			mesh));
+		if (!ret.second) {
+			throw std::runtime_error("duplicate name in index.");
+		}
+	}
+}
+
+MeshBuffer::Mesh const &MeshBuffer::lookup(std::string const &name) const {
+	auto f = index.find(name);
+	if (f == index.end()) {
+		throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
+	}
+	return f->second;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+//MeshBuffer holds the contents of a mesh blob (as written by meshes/export-meshes.py)
+// in CPU memory: the interleaved vertex data plus a name -> vertex range index.
+//It does not touch OpenGL, so it can be loaded before (or without) a context;
+// the renderer uploads 'vertices' to a vertex buffer.
+
+struct MeshBuffer {
+	//vertex format of the blob (and of the vertex buffer made from it):
+	struct Vertex {
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
+
+	//The location of a mesh in 'vertices':
+	struct Mesh {
+		GLint first = 0;
+		GLsizei count = 0;
+		//object-space bounding sphere (computed at load, used for culling):
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+		//does any vertex have alpha < 255? (if so, the mesh needs blending):
+		bool translucent = false;
+	};
+
+	//read a blob; throws on malformed data:
+	MeshBuffer(std::string const &filename);
+
+	//look up a mesh by name; throws if missing:
+	Mesh const &lookup(std::string const &name) const;
+
+	std::vector< Vertex > vertices;
+	std::map< std::string, Mesh > index;
+};
@@ -0,0 +1,198 @@
+#include "Options.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+//options that are on/off; on the command line they take no value ("--immune" or "--no-immune"):
+static bool is_flag(std::string const &name) {
+	return name == "fullscreen" || name == "offscreen" || name == "immune" || name == "check-allocations" || name == "bot" || name == "help";
+}
+
+void Options::read_file(std::string const &filename, bool required, std::vector< Setting > *settings) {
+	assert(settings);
+	std::ifstream file(filename);
+	if (!file) {
+		if (required) throw std::runtime_error("Couldn't open config file '" + filename + "'.");
+		return;
+	}
+	std::string line;
+	for (uint32_t line_number = 1; std::getline(file, line); ++line_number) {
+		line = line.substr(0, line.find('#'));
+		auto trim = [](std::string const &str) {
+			size_t begin = str.find_first_not_of(" \t\r");
+			if (begin == std::string::npos) return std::string();
+			size_t end = str.find_last_not_of(" \t\r");
+			return str.substr(begin, end + 1 - begin);
+		};
+		if (trim(line).empty()) continue;
+		std::string from = filename + ":" + std::to_string(line_number);
+		size_t equals = line.find('=');
+		if (equals == std::string::npos) {
+			throw std::runtime_error(from + ": expecting 'name = value'.");
+		}
+		settings->emplace_back(Setting{ trim(line.substr(0, equals)), trim(line.substr(equals + 1)), from });
+	}
+}
+
+void Options::read_args(int argc, char **argv, std::vector< Setting > *settings) {
+	assert(settings);
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg.substr(0, 2) != "--" || arg.size() == 2) {
+			throw std::runtime_error("Unexpected argument '" + arg + "' (options start with '--').");
+		}
+		std::string name = arg.substr(2);
+		if (is_flag(name)) {
+			settings->emplace_back(Setting{ name, "true", arg });
+		} else if (name.substr(0, 3) == "no-" && is_flag(name.substr(3))) {
+			settings->emplace_back(Setting{ name.substr(3), "false", arg });
+		} else if (argi + 1 < argc) {
+			settings->emplace_back(Setting{ name, argv[++argi], arg });
+		} else {
+			throw std::runtime_error("Expecting a value after '" + arg + "'.");
+		}
+	}
+}
+
+void Options::apply(std::vector< Setting > const &settings) {
+	//(the scenario is picked first, so that the adjustments apply to it wherever they appear)
+	for (Setting const &setting : settings) {
+		if (setting.name == "scenario") {
+			try {
+				scenario = Scenario::named(setting.value);
+			} catch (std::exception &e) {
+				throw std::runtime_error(setting.from + ": " + e.what());
+			}
+		}
+	}
+
+	for (Setting const &setting : settings) {
+		std::string const &name = setting.name;
+		std::string const &value = setting.value;
+		auto bad_value = [&setting](std::string const &expecting) {
+			return std::runtime_error(setting.from + ": '" + setting.value + "' isn't a valid " + setting.name + " (expecting " + expecting + ").");
+		};
+		auto to_bool = [&]() {
+			if (value == "true" || value == "yes" || value == "on" || value == "1") return true;
+			if (value == "false" || value == "no" || value == "off" || value == "0") return false;
+			throw bad_value("true or false");
+		};
+		auto to_uint = [&]() {
+			std::istringstream in(value);
+			uint64_t ret = 0;
+			if (value.empty() || value[0] == '-' || !(in >> ret) || !(in >> std::ws).eof() || ret > 0xffffffffULL) {
+				throw bad_value("a whole number");
+			}
+			return uint32_t(ret);
+		};
+		auto to_float = [&]() {
+			std::istringstream in(value);
+			float ret = 0.0f;
+			if (!(in >> ret) || !(in >> std::ws).eof() || !(ret >= 0.0f)) {
+				throw bad_value("a non-negative number");
+			}
+			return ret;
+		};
+
+		if (name == "config" || name == "help" || name == "scenario") {
+			//(handled elsewhere)
+		} else if (name == "title") {
+			title = value;
+		} else if (name == "size") {
+			std::istringstream in(value);
+			char x = '\0';
+			uint32_t w = 0, h = 0;
+			if (!(in >> w >> x >> h) || x != 'x' || !(in >> std::ws).eof() || w == 0 || h == 0) {
+				throw bad_value("WIDTHxHEIGHT, e.g. 1280x720");
+			}
+			size = glm::uvec2(w, h);
+		} else if (name == "fullscreen") {
+			fullscreen = to_bool();
+		} else if (name == "vsync") {
+			if (value == "off") vsync = VSyncOff;
+			else if (value == "on") vsync = VSyncOn;
+			else if (value == "adaptive") vsync = VSyncAdaptive;
+			else throw bad_value("off, on, or adaptive");
+		} else if (name == "tick-rate") {
+			tick_rate = to_uint();
+		} else if (name == "seed") {
+			seed = to_uint();
+			scenario.seed = seed;
+		} else if (name == "enemies") {
+			scenario.enemies = to_uint();
+		} else if (name == "targets") {
+			scenario.targets = to_uint();
+		} else if (name == "spawn-rate") {
+			scenario.spawn_rate = to_float();
+		} else if (name == "state-mix") {
+			try {
+				scenario.set_state_mix(value);
+			} catch (std::exception &e) {
+				throw std::runtime_error(setting.from + ": " + e.what());
+			}
+		} else if (name == "golden-period") {
+			scenario.golden_period = to_float();
+		} else if (name == "immune") {
+			scenario.immune = to_bool();
+		} else if (name == "rewind") {
+			rewind = to_uint();
+		} else if (name == "bot") {
+			bot = to_bool();
+		} else if (name == "offscreen") {
+			offscreen = to_bool();
+		} else if (name == "frames") {
+			frames = to_uint();
+		} else if (name == "record") {
+			replay_out = value;
+		} else if (name == "replay") {
+			replay_in = value;
+		} else if (name == "profile") {
+			profile_out = value;
+		} else if (name == "capture") {
+			capture_prefix = value;
+		} else if (name == "check-allocations") {
+			check_allocations = to_bool();
+		} else if (name == "shading") {
+			if (value == "pixel") shading_tier = PerPixelShading;
+			else if (value == "vertex") shading_tier = PerVertexShading;
+			else if (value == "baked") shading_tier = BakedShading;
+			else throw bad_value("pixel, vertex, or baked");
+		} else if (name == "max-frames-in-flight") {
+			max_frames_in_flight = std::max(1U, to_uint());
+		} else if (name == "max-fps") {
+			max_fps = to_uint();
+		} else {
+			throw std::runtime_error(setting.from + ": unknown option '" + name + "'.");
+		}
+	}
+}
+
+std::string Options::usage() {
+	return
+		"Options (on the command line as '--name value', or as 'name = value' lines in a config file):\n"
+		"  config FILE             read options from FILE (default: options.txt in the user directory, if present)\n"
+		"  title TEXT              window title\n"
+		"  size WxH                window size (default 640x400)\n"
+		"  fullscreen              fill the desktop\n"
+		"  vsync off|on|adaptive   swap policy (default adaptive)\n"
+		"  tick-rate HZ            fixed simulation steps per second (default 0: one step per frame)\n"
+		"  seed N                  random seed for the game and scenario\n"
+		"  scenario NAME           game, small, medium, or large; adjusted by:\n"
+		"    enemies N, targets N, spawn-rate R, state-mix c,f,p,w,ci,h, golden-period S, immune\n"
+		"  rewind SECONDS          keep a history to step back through with Backspace\n"
+		"  bot                     a bot plays, planning launches on copies of the game\n"
+		"  offscreen               no window; scripted player, fixed time step\n"
+		"  frames N                quit after N frames\n"
+		"  record FILE             save this run's input and time steps\n"
+		"  replay FILE             play back a recorded run\n"
+		"  profile FILE            write per-frame timings (CSV)\n"
+		"  capture PREFIX          save every frame as PREFIX00000.png, ...\n"
+		"  check-allocations       fail on heap allocations in update/draw after warm-up\n"
+		"  shading pixel|vertex|baked\n"
+		"  max-frames-in-flight N  GPU queue depth (default 2)\n"
+		"  max-fps N               sleep-based frame cap (default 0: none)\n"
+		"On/off options take no value on the command line ('--immune', '--no-immune').\n";
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "DrawList.hpp"
+#include "Scenario.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Options are the runtime settings of main(); each one can come from the command line
+// ("--name value", or just "--name" for on/off options) or from a config file of
+// "name = value" lines ('#' starts a comment). The config file is user_path("options.txt"),
+// if it exists, or the one named by "--config FILE"; the command line overrides it:
+//   dist/main --size 1280x720 --vsync off --tick-rate 120
+//   dist/main --offscreen --frames 600 --scenario medium --profile medium.csv
+
+struct Options {
+	//window:
+	std::string title = "Egg Hoarder";
+	glm::uvec2 size = glm::uvec2(640, 400); //"size WxH"
+	bool fullscreen = false; //(at the desktop's resolution)
+	enum VSync : uint8_t {
+		VSyncOff, //swap as soon as a frame is done (use with max-fps to save power)
+		VSyncOn,
+		VSyncAdaptive, //vsync, but late frames swap immediately (falls back to on)
+	} vsync = VSyncAdaptive; //"vsync off|on|adaptive"
+
+	//simulation:
+	//"tick-rate HZ": update in fixed steps of 1/HZ seconds (as many per frame as real time needs);
+	// 0 updates once per frame by the elapsed time. Offscreen runs always take one step per frame:
+	uint32_t tick_rate = 0;
+	uint32_t seed = 0; //seeds the game's random generators (see Game::rng)
+	//"scenario game|small|medium|large", adjusted by "enemies N", "targets N", "spawn-rate R",
+	// "state-mix c,f,p,w,ci,h", "golden-period S", and "immune":
+	Scenario scenario;
+
+	//"rewind SECONDS": snapshot the game 30 times a second and keep this much history;
+	// Backspace then steps back a second (0 = off; not while recording or replaying):
+	uint32_t rewind = 0;
+
+	//runs:
+	bool bot = false; //"bot": a LaunchPlanner plays (instead of the user or the offscreen script)
+	//"offscreen": no visible window; a scripted player and a fixed time step stand in
+	// for the user and the clock (so runs are repeatable), and frames are not vsync'd:
+	bool offscreen = false;
+	uint32_t frames = 0; //"frames N": quit after N frames (0 = run until closed)
+	std::string replay_out; //"record FILE": save the input and time steps of this run
+	std::string replay_in; //"replay FILE": play back a recorded run instead of taking input
+	std::string profile_out; //"profile FILE": write per-frame update/draw/frame times as CSV
+	std::string capture_prefix; //"capture PREFIX": save every frame as PREFIX00000.png, ...
+	//"check-allocations": fail if update or draw touches the heap once warmed up:
+	bool check_allocations = false;
+
+	//rendering:
+	//lighting quality; "shading pixel|vertex|baked" (F2 cycles at runtime):
+	ShadingTier shading_tier = PerPixelShading;
+	uint32_t max_frames_in_flight = 2; //"max-frames-in-flight N": GPU queue depth (1 = least input lag)
+	uint32_t max_fps = 0; //"max-fps N": sleep-based frame cap, for use with vsync off (0 = none)
+
+	//------- reading -------
+
+	struct Setting {
+		std::string name;
+		std::string value;
+		std::string from; //where it came from (for error messages)
+	};
+
+	//append the settings in a config file (if 'required' is false, a missing file is fine);
+	// throws if the file is malformed:
+	static void read_file(std::string const &filename, bool required, std::vector< Setting > *settings);
+	//append the settings on the command line; throws on stray arguments:
+	static void read_args(int argc, char **argv, std::vector< Setting > *settings);
+
+	//apply settings in order (except that a "scenario" setting goes first, so the
+	// adjustments always apply to it); throws on unknown names and bad values:
+	void apply(std::vector< Setting > const &settings);
+
+	//a summary of every option, for --help and error messages:
+	static std::string usage();
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+//Random is a small generator (PCG32, see pcg-random.org) whose whole state is two
+// words, so that it can be copied into and out of snapshots like any other value
+// (unlike std::rand, whose state is hidden, or std::mt19937, which is 2.5kB):
+//   Random rng(seed);
+//   float f = rng.range(-1.0f, 1.0f);
+
+struct Random {
+	uint64_t state = 0;
+	uint64_t increment = 1; //(selects the stream; always odd)
+
+	Random() = default;
+	explicit Random(uint64_t seed, uint64_t stream = 0) {
+		increment = (stream << 1) | 1;
+		(*this)();
+		state += seed;
+		(*this)();
+	}
+
+	uint32_t operator()() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + increment;
+		uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+		uint32_t rot = uint32_t(old >> 59);
+		return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+	}
+
+	//in [0,1):
+	float unit() { return float((*this)() >> 8) * (1.0f / 16777216.0f); }
+	//in [min,max):
+	float range(float min, float max) { return min + (max - min) * unit(); }
+};
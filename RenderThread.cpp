@@ -0,0 +1,115 @@
+#include "RenderThread.hpp"
+
+#include "Renderer.hpp"
+#include "gl_state.hpp"
+#include "FrameCapture.hpp"
+#include "allocation_tracker.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+RenderThread::RenderThread(SDL_Window *_window, SDL_GLContext _context, MeshBuffer const &meshes, Settings const &_settings) : window(_window), context(_context), settings(_settings) {
+	thread = std::thread(&RenderThread::run, this, &meshes);
+
+	//wait for the renderer to finish loading (the mesh buffer must stay alive until then):
+	while (!ready.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (init_error) {
+		thread.join();
+		std::rethrow_exception(init_error);
+	}
+}
+
+RenderThread::~RenderThread() {
+	stop();
+}
+
+void RenderThread::stop() {
+	quit.store(true, std::memory_order_release);
+	if (thread.joinable()) thread.join();
+}
+
+void RenderThread::submit() {
+	frames.publish();
+	//don't get more than one frame ahead of the renderer (it paces us via swap):
+	while (!frames.consumed() && !quit.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+void RenderThread::run(MeshBuffer const *meshes) {
+	AllocationZone zone(ZoneRender);
+
+	if (SDL_GL_MakeCurrent(window, context) != 0) {
+		init_error = std::make_exception_ptr(std::runtime_error(std::string("Failed to make context current on render thread: ") + SDL_GetError()));
+		ready.store(true, std::memory_order_release);
+		return;
+	}
+
+	std::unique_ptr< Renderer > renderer;
+	try {
+		renderer.reset(new Renderer(*meshes));
+	} catch (...) {
+		init_error = std::current_exception();
+		SDL_GL_MakeCurrent(window, NULL);
+		ready.store(true, std::memory_order_release);
+		return;
+	}
+	meshes = nullptr; //(not guaranteed to outlive construction)
+	ready.store(true, std::memory_order_release);
+
+	std::unique_ptr< GPUFrameQueue > queue(new GPUFrameQueue(settings.max_frames_in_flight));
+
+	std::unique_ptr< FrameCapture > capture;
+	if (!settings.capture_prefix.empty()) {
+		capture.reset(new FrameCapture(settings.capture_prefix));
+		renderer->dynamic_resolution.enabled = false;
+	}
+
+	while (!quit.load(std::memory_order_acquire)) {
+		if (!frames.acquire()) {
+			//nothing new to draw yet:
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+		DrawList const &list = frames.read_buffer();
+
+		//don't let the driver queue up more than max_frames_in_flight frames:
+		queue->begin_frame();
+
+		renderer->draw(list);
+
+		if (capture) capture->capture(list.drawable_size, uint32_t(totals.frames.load()));
+
+		//wait until the recently-drawn frame is shown before doing it all again:
+		SDL_GL_SwapWindow(window);
+		queue->end_frame(list.input_time);
+
+		totals.frames += 1;
+		totals.draws += renderer->frame_stats.draws;
+		totals.culled += list.culled;
+		if (renderer->frame_stats.resolution_scale < 1.0f) totals.scaled_frames += 1;
+	}
+
+	totals.gl_issued = gl_state.issued;
+	totals.gl_elided = gl_state.elided;
+	totals.ring_waits = renderer->instance_ring.waits;
+	totals.ring_grows = renderer->instance_ring.grows;
+	totals.queue_waits = queue->waits;
+	totals.latency_ms = queue->latency_ms;
+	queue.reset();
+
+	if (capture) {
+		capture->finish(); //(writes out the last few frames)
+		totals.captured = capture->captured;
+		totals.capture_waits = capture->readback_waits;
+		capture.reset();
+	}
+
+	renderer.reset();
+	SDL_GL_MakeCurrent(window, NULL);
+}
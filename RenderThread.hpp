@@ -0,0 +1,74 @@
+#pragma once
+
+#include "DrawList.hpp"
+#include "MeshBuffer.hpp"
+#include "TripleBuffer.hpp"
+#include "FramePacer.hpp"
+
+#include <SDL.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+
+//RenderThread runs a Renderer on its own thread, which owns the OpenGL context.
+//The main thread fills in frames.write_buffer() (via Game::draw), then calls submit();
+// the render thread picks up the latest submitted DrawList, draws it, and swaps.
+//This lets simulation of frame N+1 overlap with GL submission and swap of frame N.
+
+struct RenderThread {
+	//'context' must have been created for 'window' and must not be current on
+	// the calling thread; the constructor returns once the renderer is ready
+	// (and rethrows anything the renderer's constructor threw):
+	struct Settings {
+		//if non-empty, every frame is also saved as capture_prefix + "NNNNN.png"
+		// (asynchronously, see FrameCapture; dynamic resolution is turned off, so captures are repeatable):
+		std::string capture_prefix;
+		//most frames the driver may have queued (see GPUFrameQueue); fewer means less input lag:
+		uint32_t max_frames_in_flight = 2;
+	};
+	RenderThread(SDL_Window *window, SDL_GLContext context, MeshBuffer const &meshes, Settings const &settings);
+	~RenderThread(); //calls stop()
+
+	//stop and join the thread; context is left not current (safe to call more than once):
+	void stop();
+
+	//the DrawList the caller should fill in next:
+	DrawList &next_frame() { return frames.write_buffer(); }
+
+	//hand the filled-in DrawList to the render thread; waits (briefly) so
+	// that the caller never runs more than one frame ahead of the renderer:
+	void submit();
+
+	//running totals, updated by the render thread:
+	struct Totals {
+		std::atomic< uint64_t > frames{0};
+		std::atomic< uint64_t > draws{0};
+		std::atomic< uint64_t > culled{0};
+		std::atomic< uint64_t > gl_issued{0};
+		std::atomic< uint64_t > gl_elided{0};
+		std::atomic< uint64_t > ring_waits{0}; //times streaming instance data had to wait on the GPU
+		std::atomic< uint64_t > ring_grows{0};
+		std::atomic< uint64_t > scaled_frames{0}; //frames drawn below full resolution
+		std::atomic< uint64_t > captured{0}; //frames saved (see FrameCapture)
+		std::atomic< uint64_t > capture_waits{0}; //times capture had to wait for a readback
+		std::atomic< uint64_t > queue_waits{0}; //times the frame queue was full
+		RunningStats latency_ms; //input-to-GPU-done latency (only valid once stopped)
+	} totals;
+
+private:
+	void run(MeshBuffer const *meshes);
+
+	SDL_Window *window;
+	SDL_GLContext context;
+	Settings settings;
+
+	TripleBuffer< DrawList > frames;
+	std::atomic< bool > ready{false}; //renderer constructed (or failed)
+	std::atomic< bool > quit{false};
+	std::exception_ptr init_error;
+
+	std::thread thread;
+};
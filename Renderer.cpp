@@ -0,0 +1,621 @@
+#include "Renderer.hpp"
+
+#include "gl_errors.hpp" //helper for dumpping OpenGL error messages
+#include "gl_state.hpp" //shadowed GL state, skips redundant binds
+#include "gl_features.hpp" //optional fast paths
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+
+//helper defined later; throws if shader compilation fails:
+static GLuint compile_shader(GLenum type, std::string const &source);
+
+//layout of a glMultiDrawArraysIndirect command:
+struct DrawArraysIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+};
+static_assert(sizeof(DrawArraysIndirectCommand) == 16, "DrawArraysIndirectCommand is packed.");
+
+//(re)specify a buffer's contents -- without disturbing the bindings when direct state access is available:
+static void buffer_data(GLuint buffer, GLsizeiptr size, void const *data, GLenum usage) {
+	if (gl_features.direct_state_access) {
+		gl_features.NamedBufferData(buffer, size, data, usage);
+	} else {
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+//the (constant) lights, shared by the shaders and by scenery baking:
+static glm::vec3 const sun_color = glm::vec3(0.81f, 0.81f, 0.76f);
+static glm::vec3 const sun_direction = glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f));
+static glm::vec3 const sky_color = glm::vec3(0.2f, 0.2f, 0.3f);
+static glm::vec3 const sky_direction = glm::vec3(0.0f, 1.0f, 0.0f);
+
+//sun/sky (well, directional+hemispherical) lighting for unit normal 'n':
+static char const *lighting_glsl =
+	"uniform vec3 sun_direction;\n"
+	"uniform vec3 sun_color;\n"
+	"uniform vec3 sky_direction;\n"
+	"uniform vec3 sky_color;\n"
+	"vec3 lighting(vec3 n) {\n"
+	"	vec3 total_light = vec3(0.0, 0.0, 0.0);\n"
+	"	{ //sky (hemisphere) light:\n"
+	"		vec3 l = sky_direction;\n"
+	"		float nl = 0.5 + 0.5 * dot(n,l);\n"
+	"		total_light += nl * sky_color;\n"
+	"	}\n"
+	"	{ //sun (directional) light:\n"
+	"		vec3 l = sun_direction;\n"
+	"		float nl = max(0.0, dot(n,l));\n"
+	"		total_light += nl * sun_color;\n"
+	"	}\n"
+	"	return total_light;\n"
+	"}\n";
+
+//...and the same thing on the CPU:
+static glm::vec3 lighting(glm::vec3 n) {
+	glm::vec3 total_light = (0.5f + 0.5f * glm::dot(n, sky_direction)) * sky_color;
+	total_light += std::max(0.0f, glm::dot(n, sun_direction)) * sun_color;
+	return total_light;
+}
+
+//vertex attributes and per-instance transform, shared by every shading program:
+static char const *vertex_inputs_glsl =
+	"uniform mat4 world_to_clip;\n"
+	"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
+	"in vec3 Normal;\n"
+	"in vec4 Color;\n"
+	"in mat4x3 ObjectToWorld;\n" //per-instance; identity when no instance data is bound
+	"in mat3 NormalToWorld;\n"; //per-instance; identity when no instance data is bound
+
+//link a program and read back its locations; if 'attributes_from' is given, attribute
+// locations are bound to match it (so that one vertex array object serves every program):
+static void link_program(Renderer::ShadingProgram *_program, GLuint vertex_shader, GLuint fragment_shader, Renderer::ShadingProgram const *attributes_from) {
+	assert(_program);
+	auto &program = *_program;
+
+	program.program = glCreateProgram();
+	glAttachShader(program.program, vertex_shader);
+	glAttachShader(program.program, fragment_shader);
+
+	if (attributes_from) {
+		auto bind = [&](GLuint location, char const *name) {
+			if (location != -1U) glBindAttribLocation(program.program, location, name);
+		};
+		bind(attributes_from->Position_vec4, "Position");
+		bind(attributes_from->Normal_vec3, "Normal");
+		bind(attributes_from->Color_vec4, "Color");
+		bind(attributes_from->ObjectToWorld_mat4x3, "ObjectToWorld");
+		bind(attributes_from->NormalToWorld_mat3, "NormalToWorld");
+	}
+
+	//link the shader program and throw errors if linking fails:
+	glLinkProgram(program.program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program.program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "Failed to link shader program." << std::endl;
+		GLint info_log_length = 0;
+		glGetProgramiv(program.program, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetProgramInfoLog(program.program, GLsizei(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		throw std::runtime_error("failed to link program");
+	}
+
+	//read back uniform and attribute locations from the shader program:
+	program.world_to_clip_mat4 = glGetUniformLocation(program.program, "world_to_clip");
+
+	program.sun_direction_vec3 = glGetUniformLocation(program.program, "sun_direction");
+	program.sun_color_vec3 = glGetUniformLocation(program.program, "sun_color");
+	program.sky_direction_vec3 = glGetUniformLocation(program.program, "sky_direction");
+	program.sky_color_vec3 = glGetUniformLocation(program.program, "sky_color");
+
+	program.Position_vec4 = glGetAttribLocation(program.program, "Position");
+	program.Normal_vec3 = glGetAttribLocation(program.program, "Normal");
+	program.Color_vec4 = glGetAttribLocation(program.program, "Color");
+	program.ObjectToWorld_mat4x3 = glGetAttribLocation(program.program, "ObjectToWorld");
+	program.NormalToWorld_mat3 = glGetAttribLocation(program.program, "NormalToWorld");
+
+	//the lights never change, so set them once:
+	gl_state.use_program(program.program);
+	if (program.sun_color_vec3 != -1U) glUniform3fv(program.sun_color_vec3, 1, glm::value_ptr(sun_color));
+	if (program.sun_direction_vec3 != -1U) glUniform3fv(program.sun_direction_vec3, 1, glm::value_ptr(sun_direction));
+	if (program.sky_color_vec3 != -1U) glUniform3fv(program.sky_color_vec3, 1, glm::value_ptr(sky_color));
+	if (program.sky_direction_vec3 != -1U) glUniform3fv(program.sky_direction_vec3, 1, glm::value_ptr(sky_direction));
+	gl_state.use_program(0);
+}
+
+Renderer::Renderer(MeshBuffer const &meshes) : mesh_vertices(meshes.vertices), instance_ring(GL_ARRAY_BUFFER, 1 << 20) {
+	if (gl_features.parallel_shader_compile) {
+		//let the driver pick how many threads to compile with:
+		gl_features.MaxShaderCompilerThreads(0xffffffff);
+	}
+
+	//fragment shader that just passes along the (already lit) vertex color:
+	GLuint color_fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	{ //create an opengl program that lights each pixel:
+		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, std::string(
+			"#version 330\n") + vertex_inputs_glsl +
+			"out vec3 position;\n"
+			"out vec3 normal;\n"
+			"out vec4 color;\n"
+			"void main() {\n"
+			"	position = ObjectToWorld * Position;\n"
+			"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
+			"	normal = NormalToWorld * Normal;\n"
+			"	color = Color;\n"
+			"}\n"
+		);
+
+		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, std::string(
+			"#version 330\n") + lighting_glsl +
+			"in vec3 position;\n"
+			"in vec3 normal;\n"
+			"in vec4 color;\n"
+			"out vec4 fragColor;\n"
+			"void main() {\n"
+			"	fragColor = vec4(color.rgb * lighting(normalize(normal)), color.a);\n"
+			"}\n"
+		);
+
+		link_program(&simple_shading, vertex_shader, fragment_shader, nullptr);
+		//shaders are reference counted so this makes sure they are freed after program is deleted:
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+	}
+
+	{ //create an opengl program that lights each vertex (Gouraud shading):
+		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, std::string(
+			"#version 330\n") + vertex_inputs_glsl + lighting_glsl +
+			"out vec4 color;\n"
+			"void main() {\n"
+			"	gl_Position = world_to_clip * vec4(ObjectToWorld * Position, 1.0);\n"
+			"	color = vec4(Color.rgb * lighting(normalize(NormalToWorld * Normal)), Color.a);\n"
+			"}\n"
+		);
+		link_program(&vertex_shading, vertex_shader, color_fragment_shader, &simple_shading);
+		glDeleteShader(vertex_shader);
+	}
+
+	{ //create an opengl program for vertices whose colors already include lighting:
+		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, std::string(
+			"#version 330\n") + vertex_inputs_glsl +
+			"out vec4 color;\n"
+			"void main() {\n"
+			"	gl_Position = world_to_clip * vec4(ObjectToWorld * Position, 1.0);\n"
+			"	color = Color;\n"
+			"}\n"
+		);
+		link_program(&unlit_shading, vertex_shader, color_fragment_shader, &simple_shading);
+		glDeleteShader(vertex_shader);
+	}
+
+	glDeleteShader(color_fragment_shader);
+
+	{ //upload vertex data to the graphics card:
+		glGenBuffers(1, &meshes_vbo);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, meshes_vbo); //(named buffers only exist once bound)
+		buffer_data(meshes_vbo, sizeof(MeshBuffer::Vertex) * mesh_vertices.size(), mesh_vertices.data(), GL_STATIC_DRAW);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	//point the simple_shading vertex attributes at the Vertex-format buffer currently bound to GL_ARRAY_BUFFER:
+	auto set_vertex_attributes = [this]() {
+		//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
+		glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(MeshBuffer::Vertex), (GLbyte *)0 + offsetof(MeshBuffer::Vertex, Position));
+		glEnableVertexAttribArray(simple_shading.Position_vec4);
+		if (simple_shading.Normal_vec3 != -1U) {
+			glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(MeshBuffer::Vertex), (GLbyte *)0 + offsetof(MeshBuffer::Vertex, Normal));
+			glEnableVertexAttribArray(simple_shading.Normal_vec3);
+		}
+		if (simple_shading.Color_vec4 != -1U) {
+			glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MeshBuffer::Vertex), (GLbyte *)0 + offsetof(MeshBuffer::Vertex, Color));
+			glEnableVertexAttribArray(simple_shading.Color_vec4);
+		}
+	};
+
+	//enable the per-instance attributes (their pointers are set per-batch at draw time):
+	auto enable_instance_attributes = [this]() {
+		for (GLuint c = 0; c < 4; ++c) {
+			if (simple_shading.ObjectToWorld_mat4x3 == -1U) break;
+			glEnableVertexAttribArray(simple_shading.ObjectToWorld_mat4x3 + c);
+			glVertexAttribDivisor(simple_shading.ObjectToWorld_mat4x3 + c, 1);
+		}
+		for (GLuint c = 0; c < 3; ++c) {
+			if (simple_shading.NormalToWorld_mat3 == -1U) break;
+			glEnableVertexAttribArray(simple_shading.NormalToWorld_mat3 + c);
+			glVertexAttribDivisor(simple_shading.NormalToWorld_mat3 + c, 1);
+		}
+	};
+
+	{ //create vertex array object to hold the map from the mesh vertex buffer (+ streamed instances) to shader program attributes:
+		glGenVertexArrays(1, &meshes_for_simple_shading_vao);
+		gl_state.bind_vertex_array(meshes_for_simple_shading_vao);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, meshes_vbo);
+		set_vertex_attributes();
+		enable_instance_attributes();
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+		gl_state.bind_vertex_array(0);
+	}
+
+	{ //create a second vertex array object that pulls per-instance data for the HUD from its own buffer:
+		glGenBuffers(1, &hud_instances_vbo);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, hud_instances_vbo); //(named buffers only exist once bound)
+
+		glGenVertexArrays(1, &hud_for_simple_shading_vao);
+		gl_state.bind_vertex_array(hud_for_simple_shading_vao);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, meshes_vbo);
+		set_vertex_attributes();
+		enable_instance_attributes();
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+		gl_state.bind_vertex_array(0);
+	}
+
+	{ //create a vertex array object for the baked scenery (contents are filled in by update_scenery):
+		glGenBuffers(1, &scenery_vbo);
+
+		glGenVertexArrays(1, &scenery_for_simple_shading_vao);
+		gl_state.bind_vertex_array(scenery_for_simple_shading_vao);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, scenery_vbo);
+		set_vertex_attributes();
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+		gl_state.bind_vertex_array(0);
+	}
+
+	GL_ERRORS();
+}
+
+Renderer::~Renderer() {
+	glDeleteVertexArrays(1, &scenery_for_simple_shading_vao);
+	gl_state.forget_vertex_array(scenery_for_simple_shading_vao);
+	scenery_for_simple_shading_vao = -1U;
+
+	glDeleteBuffers(1, &scenery_vbo);
+	gl_state.forget_buffer(scenery_vbo);
+	scenery_vbo = -1U;
+
+	glDeleteVertexArrays(1, &hud_for_simple_shading_vao);
+	gl_state.forget_vertex_array(hud_for_simple_shading_vao);
+	hud_for_simple_shading_vao = -1U;
+
+	glDeleteBuffers(1, &hud_instances_vbo);
+	gl_state.forget_buffer(hud_instances_vbo);
+	hud_instances_vbo = -1U;
+
+	glDeleteVertexArrays(1, &meshes_for_simple_shading_vao);
+	gl_state.forget_vertex_array(meshes_for_simple_shading_vao);
+	meshes_for_simple_shading_vao = -1U;
+
+	glDeleteBuffers(1, &meshes_vbo);
+	gl_state.forget_buffer(meshes_vbo);
+	meshes_vbo = -1U;
+
+	for (ShadingProgram *program : { &unlit_shading, &vertex_shading, &simple_shading }) {
+		glDeleteProgram(program->program);
+		gl_state.forget_program(program->program);
+		program->program = -1U;
+	}
+
+	GL_ERRORS();
+}
+
+//clip a convex polygon to the half-plane coord(axis) * side <= limit * side:
+static void clip_polygon(std::vector< MeshBuffer::Vertex > const &in, std::vector< MeshBuffer::Vertex > *_out, int axis, float limit, float side) {
+	assert(_out);
+	auto &out = *_out;
+	out.clear();
+	for (size_t i = 0; i < in.size(); ++i) {
+		MeshBuffer::Vertex const &a = in[i];
+		MeshBuffer::Vertex const &b = in[(i + 1) % in.size()];
+		float da = (a.Position[axis] - limit) * side;
+		float db = (b.Position[axis] - limit) * side;
+		if (da <= 0.0f) out.emplace_back(a);
+		if ((da < 0.0f && db > 0.0f) || (da > 0.0f && db < 0.0f)) {
+			float t = da / (da - db);
+			MeshBuffer::Vertex v;
+			v.Position = a.Position + t * (b.Position - a.Position);
+			v.Normal = a.Normal + t * (b.Normal - a.Normal);
+			glm::vec4 color = glm::vec4(a.Color) + t * (glm::vec4(b.Color) - glm::vec4(a.Color));
+			v.Color = glm::u8vec4(color + glm::vec4(0.5f));
+			out.emplace_back(v);
+		}
+	}
+}
+
+void Renderer::update_scenery(DrawList const &list) {
+	bool baked = (list.shading_tier == BakedShading);
+	if (scenery.version == list.scenery_version && scenery.view_min == list.view_min && scenery.view_max == list.view_max && scenery.baked == baked) return;
+	scenery.version = list.scenery_version;
+	scenery.view_min = list.view_min;
+	scenery.view_max = list.view_max;
+	scenery.baked = baked;
+
+	glm::vec2 const &view_min = list.view_min;
+	glm::vec2 const &view_max = list.view_max;
+
+	scenery.vertices.clear();
+
+	std::vector< MeshBuffer::Vertex > poly, temp;
+	for (DrawPacket const &piece : list.scenery) {
+		Affine const &object_to_world = piece.object_to_world;
+		glm::mat3 normal_to_world = object_to_world.normal_matrix();
+		for (GLsizei i = 0; i + 2 < piece.count; i += 3) {
+			poly.clear();
+			for (GLsizei j = 0; j < 3; ++j) {
+				MeshBuffer::Vertex v = mesh_vertices[piece.first + i + j];
+				v.Position = object_to_world.transform_point(v.Position);
+				v.Normal = glm::normalize(normal_to_world * v.Normal);
+				if (baked) {
+					//the lights are constant, so fold them into the vertex color:
+					glm::vec3 lit = glm::vec3(v.Color) * lighting(v.Normal);
+					lit = glm::min(lit + glm::vec3(0.5f), glm::vec3(255.0f));
+					v.Color = glm::u8vec4(glm::vec4(lit, float(v.Color.a)));
+				}
+				poly.emplace_back(v);
+			}
+			clip_polygon(poly, &temp, 0, view_min.x,-1.0f);
+			clip_polygon(temp, &poly, 0, view_max.x, 1.0f);
+			clip_polygon(poly, &temp, 1, view_min.y,-1.0f);
+			clip_polygon(temp, &poly, 1, view_max.y, 1.0f);
+			//triangle fan:
+			for (size_t k = 1; k + 1 < poly.size(); ++k) {
+				scenery.vertices.emplace_back(poly[0]);
+				scenery.vertices.emplace_back(poly[k]);
+				scenery.vertices.emplace_back(poly[k+1]);
+			}
+		}
+	}
+
+	buffer_data(scenery_vbo, sizeof(MeshBuffer::Vertex) * scenery.vertices.size(), scenery.vertices.data(), GL_STATIC_DRAW);
+}
+
+void Renderer::set_instance_attributes(GLintptr offset) {
+	for (GLuint c = 0; c < 4; ++c) {
+		if (simple_shading.ObjectToWorld_mat4x3 == -1U) break;
+		glVertexAttribPointer(simple_shading.ObjectToWorld_mat4x3 + c, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLbyte *)0 + offset + offsetof(InstanceData, object_to_world) + sizeof(glm::vec3) * c);
+	}
+	for (GLuint c = 0; c < 3; ++c) {
+		if (simple_shading.NormalToWorld_mat3 == -1U) break;
+		glVertexAttribPointer(simple_shading.NormalToWorld_mat3 + c, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLbyte *)0 + offset + offsetof(InstanceData, normal_to_world) + sizeof(glm::vec3) * c);
+	}
+}
+
+void Renderer::draw(DrawList const &list) {
+	frame_stats = FrameStats();
+
+	glm::uvec2 render_size = dynamic_resolution.begin_frame(list.drawable_size);
+	frame_stats.resolution_scale = dynamic_resolution.scale;
+	if (viewport_size != render_size) {
+		viewport_size = render_size;
+		glViewport(0, 0, viewport_size.x, viewport_size.y);
+	}
+
+	//clear the depth+color buffers and set some default state:
+	gl_state.clear_color(0.5f, 0.5f, 0.5f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gl_state.enable(GL_DEPTH_TEST);
+	//(blending is enabled only for the translucent pass, below)
+
+	glm::mat4 const &world_to_clip = list.world_to_clip;
+
+	//pick programs for the shading tier
+	// (the baked tier draws the pre-lit scenery unlit and lights everything else per-vertex):
+	ShadingProgram const &object_program = (list.shading_tier == PerPixelShading ? simple_shading : vertex_shading);
+	ShadingProgram const &scenery_program = (list.shading_tier == BakedShading ? unlit_shading : object_program);
+
+	//(lights were set when the programs were linked; only the camera changes)
+	for (ShadingProgram const *program : { &scenery_program, &object_program }) {
+		if (program->world_to_clip_mat4 == -1U) continue;
+		gl_state.use_program(program->program);
+		glUniformMatrix4fv(program->world_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	}
+
+	//helper to draw a run of sorted packets; transforms are streamed through instance_ring
+	// and consecutive packets that share a mesh become one instanced draw.
+	//With multi-draw-indirect, the draws' parameters are streamed too and the whole run is
+	// submitted with one call (each command's baseInstance selects its transforms):
+	auto draw_packets = [&](std::vector< DrawPacket >::const_iterator begin, std::vector< DrawPacket >::const_iterator end) {
+		if (begin == end) return;
+		GLsizeiptr packets = end - begin;
+		bool indirect = gl_features.multi_draw_indirect;
+
+		//one allocation holds the instances and (worst case, one per packet) the commands,
+		// so that the buffer can't be replaced between them:
+		GLsizeiptr instances_size = (sizeof(InstanceData) * packets + 15) / 16 * 16;
+		GLsizeiptr commands_size = indirect ? sizeof(DrawArraysIndirectCommand) * packets : 0;
+		RingBuffer::Allocation allocation = instance_ring.allocate(instances_size + commands_size, 16);
+
+		InstanceData *instances = reinterpret_cast< InstanceData * >(allocation.data);
+		for (auto packet = begin; packet != end; ++packet) {
+			Affine const &object_to_world = packet->object_to_world;
+			InstanceData &instance = instances[packet - begin];
+			instance.object_to_world = object_to_world.to_mat4x3();
+			//(free when the transform has no non-uniform scaling; the shaders renormalize)
+			instance.normal_to_world = object_to_world.normal_matrix();
+		}
+
+		GLsizei command_count = 0;
+		if (indirect) {
+			DrawArraysIndirectCommand *commands = reinterpret_cast< DrawArraysIndirectCommand * >(reinterpret_cast< GLbyte * >(allocation.data) + instances_size);
+			for (auto run = begin; run != end; ) {
+				auto run_end = run + 1;
+				while (run_end != end && run_end->first == run->first && run_end->count == run->count) ++run_end;
+				DrawArraysIndirectCommand &command = commands[command_count++];
+				command.count = run->count;
+				command.instance_count = GLuint(run_end - run);
+				command.first = run->first;
+				command.base_instance = GLuint(run - begin);
+				run = run_end;
+			}
+		}
+		instance_ring.unmap(allocation);
+
+		gl_state.use_program(object_program.program);
+		gl_state.bind_vertex_array(meshes_for_simple_shading_vao);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, instance_ring.buffer);
+		if (indirect) {
+			set_instance_attributes(allocation.offset);
+			gl_state.bind_buffer(GL_DRAW_INDIRECT_BUFFER, instance_ring.buffer);
+			gl_features.MultiDrawArraysIndirect(GL_TRIANGLES, (GLbyte *)0 + allocation.offset + instances_size, command_count, 0);
+			frame_stats.draws += 1;
+		} else {
+			for (auto run = begin; run != end; ) {
+				auto run_end = run + 1;
+				while (run_end != end && run_end->first == run->first && run_end->count == run->count) ++run_end;
+				set_instance_attributes(allocation.offset + sizeof(InstanceData) * (run - begin));
+				glDrawArraysInstanced(GL_TRIANGLES, run->first, run->count, GLsizei(run_end - run));
+				frame_stats.draws += 1;
+				run = run_end;
+			}
+		}
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+	};
+
+	//helper to draw the HUD egg tally:
+	auto draw_hud = [&]() {
+		if (hud_version != list.hud_version) {
+			hud_version = list.hud_version;
+			hud_instance_count = GLsizei(list.hud_instances.size());
+			//expand (xyz offset, xy scale) into the shader's instance format:
+			std::vector< InstanceData > instances(list.hud_instances.size());
+			for (size_t i = 0; i < list.hud_instances.size(); ++i) {
+				glm::vec4 const &h = list.hud_instances[i];
+				instances[i].object_to_world = glm::mat4x3(
+					glm::vec3(h.w, 0.0f, 0.0f),
+					glm::vec3(0.0f, h.w, 0.0f),
+					glm::vec3(0.0f, 0.0f, 1.0f),
+					glm::vec3(h.x, h.y, h.z)
+				);
+				instances[i].normal_to_world = glm::mat3(
+					glm::vec3(1.0f / h.w, 0.0f, 0.0f),
+					glm::vec3(0.0f, 1.0f / h.w, 0.0f),
+					glm::vec3(0.0f, 0.0f, 1.0f)
+				);
+			}
+			buffer_data(hud_instances_vbo, sizeof(InstanceData) * instances.size(), instances.data(), GL_DYNAMIC_DRAW);
+		}
+
+		if (hud_instance_count == 0) return;
+
+		gl_state.use_program(object_program.program);
+		gl_state.bind_vertex_array(hud_for_simple_shading_vao);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, hud_instances_vbo);
+		auto draw_instances = [&](DrawPacket const &mesh, GLsizei first_instance, GLsizei instance_count) {
+			if (instance_count == 0) return;
+			set_instance_attributes(sizeof(InstanceData) * first_instance);
+			glDrawArraysInstanced(GL_TRIANGLES, mesh.first, mesh.count, instance_count);
+			frame_stats.draws += 1;
+		};
+		draw_instances(list.hud_egg_mesh, 0, list.hud_egg_count);
+		draw_instances(list.hud_golden_egg_mesh, list.hud_egg_count, hud_instance_count - list.hud_egg_count);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+	};
+	bool hud_translucent = sort_key_pass(list.hud_egg_mesh.key) == TranslucentPass
+		|| sort_key_pass(list.hud_golden_egg_mesh.key) == TranslucentPass;
+
+	//helper to draw the walls and floor:
+	auto draw_scenery = [&]() {
+		update_scenery(list);
+
+		if (scenery.vertices.empty()) return;
+
+		//scenery vertices are already in world space, so read identity from the (non-array) instance attributes:
+		// (set every time, since drawing with the attribute arrays enabled leaves these values undefined)
+		for (GLuint c = 0; c < 4; ++c) {
+			if (simple_shading.ObjectToWorld_mat4x3 == -1U) break;
+			glVertexAttrib3f(simple_shading.ObjectToWorld_mat4x3 + c, c == 0 ? 1.0f : 0.0f, c == 1 ? 1.0f : 0.0f, c == 2 ? 1.0f : 0.0f);
+		}
+		for (GLuint c = 0; c < 3; ++c) {
+			if (simple_shading.NormalToWorld_mat3 == -1U) break;
+			glVertexAttrib3f(simple_shading.NormalToWorld_mat3 + c, c == 0 ? 1.0f : 0.0f, c == 1 ? 1.0f : 0.0f, c == 2 ? 1.0f : 0.0f);
+		}
+
+		gl_state.use_program(scenery_program.program);
+		gl_state.bind_vertex_array(scenery_for_simple_shading_vao);
+		glDrawArrays(GL_TRIANGLES, 0, GLsizei(scenery.vertices.size()));
+		frame_stats.draws += 1;
+	};
+	bool scenery_translucent = false;
+	for (DrawPacket const &piece : list.scenery) {
+		scenery_translucent = scenery_translucent || (sort_key_pass(piece.key) == TranslucentPass);
+	}
+
+	//packets arrive sorted (see DrawList::sort_packets), so opaque ones come first:
+	auto packet = list.packets.begin();
+	auto opaque_end = packet;
+	while (opaque_end != list.packets.end() && sort_key_pass(opaque_end->key) == OpaquePass) ++opaque_end;
+
+	{ //opaque pass: no blending, (roughly) front-to-back for early depth rejection
+		gl_state.disable(GL_BLEND);
+		gl_state.depth_mask(GL_TRUE);
+
+		draw_packets(packet, opaque_end);
+		packet = opaque_end;
+		if (!hud_translucent) draw_hud();
+		if (!scenery_translucent) draw_scenery();
+	}
+
+	if (packet != list.packets.end() || hud_translucent || scenery_translucent) {
+		//translucent pass: blended back-to-front, without depth writes
+		gl_state.enable(GL_BLEND);
+		gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		gl_state.depth_mask(GL_FALSE);
+
+		if (scenery_translucent) draw_scenery();
+		if (hud_translucent) draw_hud();
+		draw_packets(packet, list.packets.end());
+
+		gl_state.depth_mask(GL_TRUE); //(so that the next frame's clear clears depth)
+	}
+
+	//the frame's instance data can be overwritten once the GPU is past these draws:
+	instance_ring.end_frame();
+
+	//upscale (if drawn at reduced size) and update the resolution governor:
+	dynamic_resolution.end_frame();
+
+	GL_ERRORS();
+}
+
+
+//create and return an OpenGL vertex shader from source:
+static GLuint compile_shader(GLenum type, std::string const &source) {
+	GLuint shader = glCreateShader(type);
+	GLchar const *str = source.c_str();
+	GLint length = GLint(source.size());
+	glShaderSource(shader, 1, &str, &length);
+	glCompileShader(shader);
+	GLint compile_status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+	if (compile_status != GL_TRUE) {
+		std::cerr << "Failed to compile shader." << std::endl;
+		GLint info_log_length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		glDeleteShader(shader);
+		throw std::runtime_error("Failed to compile shader.");
+	}
+	return shader;
+}
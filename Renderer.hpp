@@ -0,0 +1,113 @@
+#pragma once
+
+#include "GL.hpp"
+#include "MeshBuffer.hpp"
+#include "DrawList.hpp"
+#include "RingBuffer.hpp"
+#include "DynamicResolution.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+//The Renderer owns all OpenGL resources and turns DrawLists into frames.
+//It must be constructed, used, and destroyed with its context current
+// (see RenderThread for running it on a dedicated thread).
+
+struct Renderer {
+	//uploads 'meshes' and builds shader programs; throws on failure:
+	Renderer(MeshBuffer const &meshes);
+	~Renderer();
+
+	//clear the framebuffer and draw everything in 'list':
+	void draw(DrawList const &list);
+
+	//------- opengl resources -------
+
+	//shader programs that draw objects with vertex colors (the DrawList's ShadingTier picks
+	// which are used); attribute locations are bound to match simple_shading's:
+	struct ShadingProgram {
+		GLuint program = -1U; //program object
+
+		//uniform locations:
+		GLuint world_to_clip_mat4 = -1U;
+		GLuint sun_direction_vec3 = -1U;
+		GLuint sun_color_vec3 = -1U;
+		GLuint sky_direction_vec3 = -1U;
+		GLuint sky_color_vec3 = -1U;
+
+		//attribute locations:
+		GLuint Position_vec4 = -1U;
+		GLuint Normal_vec3 = -1U;
+		GLuint Color_vec4 = -1U;
+		GLuint ObjectToWorld_mat4x3 = -1U; //per-instance (4 consecutive locations)
+		GLuint NormalToWorld_mat3 = -1U; //per-instance (3 consecutive locations)
+	};
+	ShadingProgram simple_shading; //lighting per-pixel
+	ShadingProgram vertex_shading; //lighting per-vertex (Gouraud)
+	ShadingProgram unlit_shading; //vertex colors as-is (for scenery baked with lighting)
+
+	//per-instance data, as read by simple_shading:
+	struct InstanceData {
+		glm::mat4x3 object_to_world;
+		glm::mat3 normal_to_world;
+	};
+	static_assert(sizeof(InstanceData) == 4*3*4 + 3*3*4, "InstanceData is packed.");
+
+	//point the instance attributes of the bound vertex array at InstanceData
+	// starting 'offset' bytes into the buffer bound to GL_ARRAY_BUFFER:
+	void set_instance_attributes(GLintptr offset);
+
+	//mesh data, stored in a vertex buffer:
+	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
+	std::vector< MeshBuffer::Vertex > mesh_vertices; //CPU-side copy of meshes_vbo contents, used for baking
+
+	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo (+ instances) to the simple_shading_program
+
+	//------- dynamic objects -------
+
+	//Per-packet instance data is streamed through this ring each frame:
+	RingBuffer instance_ring;
+
+	//------- HUD -------
+
+	//HUD instances (see DrawList) only change when the score does, so they are kept
+	// (as InstanceData) in hud_instances_vbo and drawn with one instanced call per mesh:
+	GLuint hud_instances_vbo = -1U;
+	GLuint hud_for_simple_shading_vao = -1U; //meshes_vbo + per-instance data from hud_instances_vbo
+	uint32_t hud_version = 0; //version of the instances currently in hud_instances_vbo
+	GLsizei hud_instance_count = 0;
+
+	//------- static scenery -------
+
+	//The walls and floor never move, so they are baked into world-space vertices
+	// (clipped to the visible world rectangle) whenever they or the view change,
+	// and drawn with a single call:
+	//In BakedShading, the (constant) lighting is folded into the baked vertex colors too.
+	struct {
+		uint32_t version = 0;
+		bool baked = false; //lighting baked in?
+		glm::vec2 view_min = glm::vec2(0.0f);
+		glm::vec2 view_max = glm::vec2(0.0f);
+		std::vector< MeshBuffer::Vertex > vertices;
+	} scenery;
+
+	GLuint scenery_vbo = -1U;
+	GLuint scenery_for_simple_shading_vao = -1U;
+
+	//re-bake the scenery (if needed) for the list's view:
+	void update_scenery(DrawList const &list);
+
+	//------- bookkeeping -------
+
+	//frames are drawn at a reduced size (and upscaled) when the GPU can't keep up:
+	DynamicResolution dynamic_resolution;
+
+	glm::uvec2 viewport_size = glm::uvec2(0);
+
+	//counters for the most recent call to draw:
+	struct FrameStats {
+		uint32_t draws = 0; //draw calls issued
+		float resolution_scale = 1.0f; //fraction of the drawable width/height rendered
+	} frame_stats;
+};
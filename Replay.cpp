@@ -0,0 +1,142 @@
+#include "Replay.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+static std::string const ReplayHeader = "egg-hoarder replay 2";
+
+void Replay::begin_frame() {
+	Frame frame;
+	frame.keys_begin = frame.keys_end = uint32_t(keys.size());
+	frame.steps_begin = frame.steps_end = uint32_t(steps.size());
+	frames.emplace_back(frame);
+}
+
+void Replay::add_key(SDL_Event const &evt) {
+	assert(!frames.empty());
+	if (evt.type != SDL_KEYDOWN && evt.type != SDL_KEYUP) return;
+	if (evt.type == SDL_KEYDOWN && evt.key.repeat) return;
+	keys.emplace_back(Key{ evt.key.timestamp, uint32_t(evt.key.keysym.scancode), evt.type == SDL_KEYDOWN });
+	frames.back().keys_end = uint32_t(keys.size());
+}
+
+void Replay::add_step(float elapsed) {
+	assert(!frames.empty());
+	steps.emplace_back(elapsed);
+	frames.back().steps_end = uint32_t(steps.size());
+}
+
+void Replay::get_keys(uint32_t frame, std::vector< SDL_Event > *events) const {
+	assert(events);
+	assert(frame < frames.size());
+	for (uint32_t k = frames[frame].keys_begin; k < frames[frame].keys_end; ++k) {
+		SDL_Event evt;
+		std::memset(&evt, 0, sizeof(evt));
+		evt.type = (keys[k].down ? SDL_KEYDOWN : SDL_KEYUP);
+		evt.key.timestamp = keys[k].timestamp;
+		evt.key.keysym.scancode = SDL_Scancode(keys[k].scancode);
+		events->emplace_back(evt);
+	}
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream file(filename);
+	if (!file) throw std::runtime_error("Couldn't open replay '" + filename + "' for writing.");
+	//(enough digits that every float reads back exactly)
+	file << std::setprecision(std::numeric_limits< float >::max_digits10);
+	file << ReplayHeader << "\n";
+	file << "seed " << seed << "\n";
+	file << "scenario " << scenario.name << "\n";
+	file << "enemies " << scenario.enemies << "\n";
+	file << "targets " << scenario.targets << "\n";
+	file << "spawn-rate " << scenario.spawn_rate << "\n";
+	file << "state-mix ";
+	for (uint32_t i = 0; i < 6; ++i) {
+		file << (i ? "," : "") << scenario.state_weights[i];
+	}
+	file << "\n";
+	file << "golden-period " << scenario.golden_period << "\n";
+	file << "golden-duration " << scenario.golden_duration << "\n";
+	file << "immune " << (scenario.immune ? 1 : 0) << "\n";
+	for (Frame const &frame : frames) {
+		file << "f " << frame.ticks;
+		for (uint32_t s = frame.steps_begin; s < frame.steps_end; ++s) {
+			file << " " << steps[s];
+		}
+		file << "\n";
+		for (uint32_t k = frame.keys_begin; k < frame.keys_end; ++k) {
+			file << "k " << keys[k].timestamp << " " << keys[k].scancode << " " << (keys[k].down ? 1 : 0) << "\n";
+		}
+	}
+	if (!file) throw std::runtime_error("Failed writing replay '" + filename + "'.");
+}
+
+Replay Replay::load(std::string const &filename) {
+	std::ifstream file(filename);
+	if (!file) throw std::runtime_error("Couldn't open replay '" + filename + "'.");
+
+	Replay replay;
+	std::string line;
+	if (!std::getline(file, line) || line != ReplayHeader) {
+		throw std::runtime_error("Replay '" + filename + "' doesn't start with '" + ReplayHeader + "'.");
+	}
+	for (uint32_t line_number = 2; std::getline(file, line); ++line_number) {
+		auto bad_line = [&]() {
+			return std::runtime_error("Replay '" + filename + "' line " + std::to_string(line_number) + " is malformed.");
+		};
+		std::istringstream in(line);
+		std::string kind;
+		if (!(in >> kind)) continue;
+		if (kind == "seed") {
+			if (!(in >> replay.seed)) throw bad_line();
+			replay.scenario.seed = replay.seed;
+		} else if (kind == "scenario") {
+			if (!(in >> replay.scenario.name)) throw bad_line();
+		} else if (kind == "enemies") {
+			if (!(in >> replay.scenario.enemies)) throw bad_line();
+		} else if (kind == "targets") {
+			if (!(in >> replay.scenario.targets)) throw bad_line();
+		} else if (kind == "spawn-rate") {
+			if (!(in >> replay.scenario.spawn_rate)) throw bad_line();
+		} else if (kind == "state-mix") {
+			std::string mix;
+			if (!(in >> mix)) throw bad_line();
+			try {
+				replay.scenario.set_state_mix(mix);
+			} catch (std::exception &) {
+				throw bad_line();
+			}
+		} else if (kind == "golden-period") {
+			if (!(in >> replay.scenario.golden_period)) throw bad_line();
+		} else if (kind == "golden-duration") {
+			if (!(in >> replay.scenario.golden_duration)) throw bad_line();
+		} else if (kind == "immune") {
+			uint32_t immune = 0;
+			if (!(in >> immune) || immune > 1) throw bad_line();
+			replay.scenario.immune = (immune == 1);
+		} else if (kind == "f") {
+			uint32_t ticks = 0;
+			if (!(in >> ticks)) throw bad_line();
+			replay.begin_frame();
+			replay.frames.back().ticks = ticks;
+			float elapsed;
+			while (in >> elapsed) replay.add_step(elapsed);
+			if (!in.eof()) throw bad_line();
+		} else if (kind == "k") {
+			Key key;
+			uint32_t down = 0;
+			if (replay.frames.empty() || !(in >> key.timestamp >> key.scancode >> down) || down > 1) throw bad_line();
+			key.down = (down == 1);
+			replay.keys.emplace_back(key);
+			replay.frames.back().keys_end = uint32_t(replay.keys.size());
+		} else {
+			throw bad_line();
+		}
+	}
+	return replay;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Scenario.hpp"
+
+#include <SDL.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//A Replay is the input of a run: the key events handed to the game and the time
+// steps given to Game::update, frame by frame. Played back (with the same options)
+// it reproduces the run exactly, whatever the machine speed:
+//   dist/main --record run.replay
+//   dist/main --replay run.replay --offscreen --profile run.csv
+//
+//The file is text: a header (the seed and every scenario setting, which playback
+// uses in place of the command line's), then one "f TICKS STEP..." line per frame
+// followed by that frame's "k TIMESTAMP SCANCODE DOWN" lines.
+
+struct Replay {
+	struct Key {
+		uint32_t timestamp;
+		uint32_t scancode;
+		bool down;
+	};
+	struct Frame {
+		uint32_t ticks = 0; //event clock when the frame's updates ran
+		uint32_t keys_begin = 0, keys_end = 0; //range in 'keys'
+		uint32_t steps_begin = 0, steps_end = 0; //range in 'steps'
+	};
+
+	uint32_t seed = 0; //(the run's random seed; playback uses it too)
+	Scenario scenario; //(the run's scenario, as adjusted; playback uses it too)
+	std::vector< Frame > frames;
+	std::vector< Key > keys;
+	std::vector< float > steps; //update() elapsed times
+
+	//recording:
+	void begin_frame(); //(then set frames.back().ticks once known)
+	void add_key(SDL_Event const &evt); //(ignores everything but key up/down)
+	void add_step(float elapsed);
+
+	//playback: the key events of 'frame', as SDL events:
+	void get_keys(uint32_t frame, std::vector< SDL_Event > *events) const;
+
+	//throws on I/O errors or malformed files:
+	void save(std::string const &filename) const;
+	static Replay load(std::string const &filename);
+};
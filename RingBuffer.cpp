@@ -0,0 +1,167 @@
+#include "RingBuffer.hpp"
+
+#include "gl_state.hpp"
+#include "gl_features.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+RingBuffer::RingBuffer(GLenum _target, GLsizeiptr size) : target(_target) {
+	create(size);
+}
+
+RingBuffer::~RingBuffer() {
+	destroy();
+}
+
+void RingBuffer::create(GLsizeiptr size) {
+	PFNGLBUFFERSTORAGEPROC buffer_storage = gl_features.BufferStorage; //(null if unsupported)
+
+	capacity = size;
+	head = 0;
+	glGenBuffers(1, &buffer);
+	gl_state.bind_buffer(target, buffer);
+	if (buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		buffer_storage(target, capacity, nullptr, flags);
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(target, 0, capacity, flags));
+		persistent = (mapped != nullptr);
+	}
+	if (!persistent) {
+		//(if the persistent path failed, the immutable buffer can't be respecified; start over)
+		if (buffer_storage) {
+			glDeleteBuffers(1, &buffer);
+			gl_state.forget_buffer(buffer);
+			glGenBuffers(1, &buffer);
+			gl_state.bind_buffer(target, buffer);
+		}
+		glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+void RingBuffer::destroy() {
+	for (uint32_t i = 0; i < MaxFrames; ++i) {
+		if (frames[i].fence) glDeleteSync(frames[i].fence);
+		frames[i] = Frame();
+	}
+	oldest = 0;
+	in_flight = 0;
+	current_used = 0;
+
+	if (buffer) {
+		if (mapped) {
+			gl_state.bind_buffer(target, buffer);
+			glUnmapBuffer(target);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &buffer);
+		gl_state.forget_buffer(buffer);
+		buffer = 0;
+	}
+	persistent = false;
+}
+
+void RingBuffer::retire_oldest() {
+	assert(in_flight > 0);
+	Frame &frame = frames[oldest];
+	GLenum result = glClientWaitSync(frame.fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		waits += 1;
+		do {
+			result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(frame.fence);
+	frame = Frame();
+	oldest = (oldest + 1) % MaxFrames;
+	in_flight -= 1;
+}
+
+void RingBuffer::wait_for(GLintptr begin, GLintptr end) {
+	//fences complete in order, so retire frames oldest-first until none overlaps [begin,end):
+	auto overlaps = [begin, end](Frame const &frame) {
+		for (uint32_t r = 0; r < frame.ranges; ++r) {
+			if (frame.begin[r] < end && begin < frame.end[r]) return true;
+		}
+		return false;
+	};
+	uint32_t last_overlap = 0; //(one past the newest overlapping frame)
+	for (uint32_t i = 0; i < in_flight; ++i) {
+		if (overlaps(frames[(oldest + i) % MaxFrames])) last_overlap = i + 1;
+	}
+	while (last_overlap > 0) {
+		retire_oldest();
+		last_overlap -= 1;
+	}
+}
+
+RingBuffer::Allocation RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	assert(alignment > 0);
+
+	GLintptr offset = (head + alignment - 1) / alignment * alignment;
+	bool wrap = (offset + size > capacity);
+	//bytes this allocation adds to the frame's footprint (including padding and any skipped tail):
+	GLsizeiptr footprint = wrap ? (capacity - head) + size : (offset - head) + size;
+
+	//if this frame alone would overrun the ring, replace the buffer with a bigger one
+	// (the old buffer lives on in the driver until the GPU is done with it):
+	if (current_used + footprint > capacity) {
+		GLsizeiptr new_capacity = capacity;
+		while (size + alignment > new_capacity / 2) new_capacity *= 2;
+		destroy();
+		create(new_capacity);
+		grows += 1;
+		offset = 0;
+		wrap = false;
+		footprint = size;
+	} else if (wrap) {
+		offset = 0;
+	}
+
+	//make sure no in-flight frame is still reading these bytes:
+	wait_for(offset, offset + size);
+
+	//record the range for this frame's fence:
+	Frame &frame = current();
+	if (frame.ranges == 0 || wrap) {
+		assert(frame.ranges < 2);
+		frame.begin[frame.ranges] = offset;
+		frame.end[frame.ranges] = offset + size;
+		frame.ranges += 1;
+	} else {
+		frame.end[frame.ranges - 1] = offset + size;
+	}
+	current_used += footprint;
+	head = offset + size;
+
+	Allocation allocation;
+	allocation.offset = offset;
+	allocation.size = size;
+	gl_state.bind_buffer(target, buffer);
+	if (persistent) {
+		allocation.data = mapped + offset;
+	} else {
+		allocation.data = glMapBufferRange(target, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!allocation.data) throw std::runtime_error("RingBuffer: failed to map buffer range.");
+	}
+	return allocation;
+}
+
+void RingBuffer::unmap(Allocation const &allocation) {
+	if (persistent) return; //(coherent mapping; nothing to do)
+	gl_state.bind_buffer(target, buffer);
+	glUnmapBuffer(target);
+}
+
+void RingBuffer::end_frame() {
+	Frame &frame = current();
+	if (frame.ranges == 0) return; //nothing to fence
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	in_flight += 1;
+	current_used = 0;
+
+	//keep a free slot for the next frame:
+	if (in_flight == MaxFrames) retire_oldest();
+}
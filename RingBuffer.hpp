@@ -0,0 +1,70 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//RingBuffer streams per-frame data (e.g., instance transforms) through one
+// large GL buffer without stalling the pipeline:
+// - allocations are carved sequentially out of the buffer, wrapping at the end;
+// - each frame's allocations are guarded by a fence (end_frame()), and the
+//   allocator only waits on a fence when it is about to reuse that frame's bytes;
+// - writes go through a persistent, coherent mapping when ARB_buffer_storage is
+//   available, and through glMapBufferRange(...UNSYNCHRONIZED...) otherwise.
+//The buffer only grows (by reallocation) when a single frame needs more than fits.
+//
+//Must be created, used, and destroyed with the GL context current.
+
+struct RingBuffer {
+	RingBuffer(GLenum target, GLsizeiptr size);
+	~RingBuffer();
+
+	struct Allocation {
+		void *data = nullptr; //write through this pointer...
+		GLintptr offset = 0; //...and reference the data at this offset in 'buffer'
+		GLsizeiptr size = 0;
+	};
+
+	//reserve 'size' bytes at an offset that is a multiple of 'alignment'
+	// (leaves 'buffer' bound to 'target'); call unmap() once written.
+	//NOTE: 'buffer' may be replaced by a bigger one, so re-read it after allocating:
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+	void unmap(Allocation const &allocation);
+
+	//fence everything allocated since the last call to end_frame:
+	// (call after the draws that read the frame's allocations have been issued)
+	void end_frame();
+
+	GLenum target;
+	GLuint buffer = 0;
+	GLsizeiptr capacity = 0;
+	bool persistent = false; //using a persistent mapping?
+
+	//counters (cumulative):
+	uint64_t waits = 0; //times allocate() actually had to block on a fence
+	uint64_t grows = 0; //times the buffer was reallocated
+
+private:
+	void create(GLsizeiptr size);
+	void destroy();
+	void wait_for(GLintptr begin, GLintptr end); //retire in-flight frames that use any of [begin,end)
+	void retire_oldest(); //wait for the oldest in-flight frame's fence
+
+	uint8_t *mapped = nullptr; //persistent mapping (if any)
+	GLintptr head = 0; //next free byte
+
+	//byte ranges used by a frame (at most two: the ring wraps at most once per frame):
+	struct Frame {
+		GLsync fence = 0;
+		GLintptr begin[2] = { 0, 0 };
+		GLintptr end[2] = { 0, 0 };
+		uint32_t ranges = 0;
+	};
+	enum { MaxFrames = 8 };
+	Frame frames[MaxFrames]; //in-flight frames (oldest at frames[oldest]) followed by the current one
+	uint32_t oldest = 0;
+	uint32_t in_flight = 0; //fenced frames
+	GLsizeiptr current_used = 0; //bytes allocated so far this frame
+
+	Frame &current() { return frames[(oldest + in_flight) % MaxFrames]; }
+};
@@ -0,0 +1,58 @@
+#include "Scenario.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+Scenario Scenario::named(std::string const &name) {
+	Scenario scenario;
+	scenario.name = name;
+	if (name == "game") {
+		//(defaults)
+	} else if (name == "small") {
+		scenario.enemies = 90;
+		scenario.targets = 10;
+		scenario.spawn_rate = 1.0f;
+		scenario.golden_period = 20.0f;
+		scenario.golden_duration = 5.0f;
+		scenario.immune = true;
+	} else if (name == "medium") {
+		scenario.enemies = 9000;
+		scenario.targets = 1000;
+		scenario.spawn_rate = 100.0f;
+		scenario.golden_period = 20.0f;
+		scenario.golden_duration = 5.0f;
+		scenario.immune = true;
+	} else if (name == "large") {
+		scenario.enemies = 900000;
+		scenario.targets = 100000;
+		scenario.spawn_rate = 10000.0f;
+		scenario.golden_period = 20.0f;
+		scenario.golden_duration = 5.0f;
+		scenario.immune = true;
+	} else {
+		throw std::runtime_error("Unknown scenario '" + name + "' (expecting game, small, medium, or large).");
+	}
+	return scenario;
+}
+
+void Scenario::set_state_mix(std::string const &mix) {
+	float weights[6];
+	std::istringstream in(mix);
+	float total = 0.0f;
+	for (uint32_t i = 0; i < 6; ++i) {
+		char comma = ',';
+		if ((i > 0 && !(in >> comma)) || comma != ',' || !(in >> weights[i]) || weights[i] < 0.0f) {
+			throw std::runtime_error("Expecting six non-negative weights (chase,flee,patrol,wander,circle,hunt) in state mix '" + mix + "'.");
+		}
+		total += weights[i];
+	}
+	if (!(in >> std::ws).eof()) {
+		throw std::runtime_error("Unexpected text after six weights in state mix '" + mix + "'.");
+	}
+	if (total <= 0.0f) {
+		throw std::runtime_error("State mix '" + mix + "' has no non-zero weights.");
+	}
+	for (uint32_t i = 0; i < 6; ++i) {
+		state_weights[i] = weights[i];
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//A Scenario says what a round starts with and how it evolves; the default is the
+// normal game. The named stress scenarios fill the board with many more entities
+// (about 10^2, 10^4 and 10^6) so that performance can be measured at scale:
+//   dist/main --scenario medium [--enemies N] [--state-mix 1,0,0,0,0,1] ...
+
+struct Scenario {
+	std::string name = "game";
+
+	uint32_t enemies = 1; //at the start of each round
+	uint32_t targets = 10; //kept on the board (refilled whenever the player lands)
+	float spawn_rate = 0.0f; //new enemies per second (0 = the game's rule: one per 100 points)
+
+	//relative odds of each enemy state, in EnemyState order
+	// (chase, flee, patrol, wander, circle, hunt); used at spawn and whenever AI re-rolls:
+	float state_weights[6] = { 3.0f, 1.0f, 3.0f, 2.0f, 1.0f, 1.0f };
+
+	float golden_period = 0.0f; //golden mode starts every this many seconds (0 = only from golden eggs)
+	float golden_duration = 7.5f; //...and lasts this long
+
+	bool immune = false; //enemies can't end the round
+	uint32_t seed = 0; //seeds the scenario's own generator (entity placement and states)
+
+	//"game", "small", "medium", or "large"; throws on unknown names:
+	static Scenario named(std::string const &name);
+
+	//set state_weights from "c,f,p,w,ci,h"; throws if malformed:
+	void set_state_mix(std::string const &mix);
+};
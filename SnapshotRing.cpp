@@ -0,0 +1,138 @@
+#include "SnapshotRing.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+SnapshotRing::SnapshotRing(uint32_t capacity, uint32_t _group_size) : group_size(std::max(1U, _group_size)) {
+	//(one group more than needed, since a whole group is dropped at a time)
+	groups.resize((capacity + group_size - 1) / group_size + 1);
+	for (Group &group : groups) {
+		group.deltas.resize(group_size - 1);
+	}
+}
+
+void SnapshotRing::push(std::vector< uint8_t > const &snapshot) {
+	if (count == groups.size() * group_size) {
+		first = (first + 1) % groups.size();
+		count -= group_size;
+	}
+	Group &group = groups[(first + count / group_size) % groups.size()];
+	uint32_t slot = count % group_size;
+	if (slot == 0) {
+		group.keyframe = snapshot; //(reuses the storage)
+	} else {
+		encode_delta(group.keyframe, snapshot, &group.deltas[slot - 1]);
+	}
+	count += 1;
+}
+
+void SnapshotRing::get(uint32_t age, std::vector< uint8_t > *_snapshot) const {
+	assert(_snapshot);
+	assert(age < count);
+	uint32_t index = count - 1 - age;
+	Group const &group = groups[(first + index / group_size) % groups.size()];
+	uint32_t slot = index % group_size;
+	if (slot == 0) {
+		*_snapshot = group.keyframe;
+	} else {
+		decode_delta(group.keyframe, group.deltas[slot - 1], _snapshot);
+	}
+}
+
+void SnapshotRing::drop_newest(uint32_t drop) {
+	count -= std::min(count, drop);
+}
+
+uint64_t SnapshotRing::stored_bytes() const {
+	uint64_t total = 0;
+	for (uint32_t index = 0; index < count; ++index) {
+		Group const &group = groups[(first + index / group_size) % groups.size()];
+		uint32_t slot = index % group_size;
+		total += (slot == 0 ? group.keyframe.size() : group.deltas[slot - 1].size());
+	}
+	return total;
+}
+
+//------- delta coding -------
+//A delta is the snapshot's size, then (zero run, literal length, literal bytes) until
+// the end; literals are the XOR of the snapshot with the base (zero-padded to length).
+//Numbers are LEB128 varints.
+
+static void put_varint(std::vector< uint8_t > *_to, uint64_t value) {
+	while (value >= 0x80) {
+		_to->emplace_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	_to->emplace_back(uint8_t(value));
+}
+
+static uint64_t get_varint(uint8_t const *&at, uint8_t const *end) {
+	uint64_t value = 0;
+	for (uint32_t shift = 0; shift < 64; shift += 7) {
+		if (at == end) throw std::runtime_error("Snapshot delta is truncated.");
+		uint8_t byte = *(at++);
+		value |= uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+	}
+	throw std::runtime_error("Snapshot delta has a malformed number.");
+}
+
+void SnapshotRing::encode_delta(std::vector< uint8_t > const &base, std::vector< uint8_t > const &snapshot, std::vector< uint8_t > *_delta) {
+	assert(_delta);
+	std::vector< uint8_t > &delta = *_delta;
+	delta.clear();
+
+	//(literals absorb short zero runs, which cost more to code than to copy)
+	size_t const MinZeroRun = 8;
+
+	size_t const size = snapshot.size();
+	size_t const common = std::min(size, base.size());
+	auto diff = [&](size_t i) -> uint8_t {
+		return snapshot[i] ^ (i < common ? base[i] : 0);
+	};
+
+	put_varint(&delta, size);
+	size_t i = 0;
+	while (i < size) {
+		size_t zeros = i;
+		while (i < size && diff(i) == 0) ++i;
+		if (i == size) break; //(trailing zeros are implied)
+		size_t end = i + 1; //one past the last differing byte
+		for (size_t j = end; j < size && j - end < MinZeroRun; ++j) {
+			if (diff(j) != 0) end = j + 1;
+		}
+		put_varint(&delta, i - zeros);
+		put_varint(&delta, end - i);
+		for (; i < end; ++i) {
+			delta.emplace_back(diff(i));
+		}
+	}
+}
+
+void SnapshotRing::decode_delta(std::vector< uint8_t > const &base, std::vector< uint8_t > const &delta, std::vector< uint8_t > *_snapshot) {
+	assert(_snapshot);
+	std::vector< uint8_t > &snapshot = *_snapshot;
+
+	uint8_t const *at = delta.data();
+	uint8_t const *end = delta.data() + delta.size();
+	uint64_t size = get_varint(at, end);
+	snapshot.resize(size);
+	size_t common = std::min(size_t(size), base.size());
+	if (common) std::memcpy(snapshot.data(), base.data(), common);
+	std::fill(snapshot.begin() + common, snapshot.end(), uint8_t(0));
+
+	size_t i = 0;
+	while (at != end) {
+		uint64_t zeros = get_varint(at, end);
+		uint64_t literal = get_varint(at, end);
+		if (zeros > size - i || literal > size - i - zeros || literal > uint64_t(end - at)) {
+			throw std::runtime_error("Snapshot delta runs past its end.");
+		}
+		i += zeros;
+		for (uint64_t l = 0; l < literal; ++l) {
+			snapshot[i++] ^= *(at++);
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//SnapshotRing keeps the most recent snapshots (e.g., from Game::save_state) in a
+// bounded amount of memory. Snapshots come in groups: the first of each group is
+// stored whole (a keyframe), the rest as run-length coded XOR differences from it,
+// which are small when little has changed. Getting any snapshot back decodes at most
+// one difference, so it takes time proportional to the snapshot's size.
+//When the ring is full, the oldest group is dropped (and its storage reused):
+//   SnapshotRing ring(30 * 10, 30); //ten seconds at 30 snapshots per second
+//   game.save_state(&bytes); ring.push(bytes);
+//   ring.get(30, &bytes); game.load_state(bytes); //one second back
+
+struct SnapshotRing {
+	//keeps at least 'capacity' snapshots (rounded up to whole groups of 'group_size'):
+	SnapshotRing(uint32_t capacity, uint32_t group_size = 30);
+
+	void push(std::vector< uint8_t > const &snapshot);
+
+	uint32_t size() const { return count; } //snapshots available
+
+	//the snapshot pushed 'age' pushes ago (0 = newest; must be less than size()):
+	void get(uint32_t age, std::vector< uint8_t > *_snapshot) const;
+
+	//forget the newest 'drop' snapshots (e.g., after rewinding to an older one):
+	void drop_newest(uint32_t drop);
+
+	void clear() { count = 0; }
+
+	uint64_t stored_bytes() const; //(for reporting the compression)
+
+	//------- internals -------
+
+	uint32_t group_size;
+	struct Group {
+		std::vector< uint8_t > keyframe;
+		std::vector< std::vector< uint8_t > > deltas; //(group_size - 1, reused)
+	};
+	std::vector< Group > groups; //a ring; the oldest is groups[first]
+	uint32_t first = 0;
+	uint32_t count = 0; //snapshots stored, oldest first from groups[first]
+
+	//encode 'snapshot' as differences from 'base', and back:
+	static void encode_delta(std::vector< uint8_t > const &base, std::vector< uint8_t > const &snapshot, std::vector< uint8_t > *_delta);
+	static void decode_delta(std::vector< uint8_t > const &base, std::vector< uint8_t > const &delta, std::vector< uint8_t > *_snapshot);
+};
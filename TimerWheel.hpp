@@ -0,0 +1,258 @@
+#pragma once
+
+#include "byte_stream.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+//TimerWheel schedules events at integer ticks and fires each one only on the tick
+// it comes due, so that waiting costs nothing per frame (a hierarchical timing wheel,
+// as in Varghese & Lauck, "Hashed and hierarchical timing wheels"):
+//   TimerWheel< Event > timers;
+//   TimerWheel< Event >::Handle h = timers.schedule(timers.now + 3000, event);
+//   timers.advance(timers.now + 16, [](Event const &e) { ... }); //(fires what came due)
+//
+//Level 0 has a slot per tick for the next 64 ticks; each level above covers 64 times
+// the span of the one below, and its timers drop down a level (are "cascaded") when
+// their slot comes up. Scheduling and cancelling are O(1); advancing costs one slot
+// visit per tick plus the timers that fire or cascade.
+//
+//All of the state is in plain arrays, so a wheel can be copied (reusing storage) or
+// saved into a snapshot with the rest of the simulation.
+
+template< typename Payload >
+struct TimerWheel {
+	static_assert(std::is_trivially_copyable< Payload >::value, "Timer payloads are saved with memcpy.");
+
+	struct Handle {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+	};
+
+	uint64_t now = 0; //the latest tick advanced to
+
+	TimerWheel() { clear(); }
+
+	//cancel everything and restart the clock at 'at':
+	void clear(uint64_t at = 0);
+	void reserve(uint32_t count) { timers.reserve(count); free_timers.reserve(count); }
+
+	//fire 'payload' at tick 'due' (or, if that has passed, on the next tick):
+	Handle schedule(uint64_t due, Payload const &payload);
+	//stop a timer (does nothing if it already fired or was cancelled):
+	void cancel(Handle handle);
+	bool pending(Handle handle) const {
+		return handle.index < timers.size() && timers[handle.index].generation == handle.generation && timers[handle.index].slot != -1U;
+	}
+	uint32_t size() const { return uint32_t(timers.size() - free_timers.size()); } //(pending timers)
+
+	//move the clock to 'to', calling fire(payload) for every timer that comes due, in
+	// tick order; fire() may schedule and cancel timers:
+	template< typename F >
+	void advance(uint64_t to, F &&fire);
+
+	//append the wheel to '_to' / replace it with what was saved (throws if malformed,
+	// leaving the wheel as it was):
+	void save(std::vector< uint8_t > *_to) const;
+	void load(ByteReader *from);
+	//read past a save() without changing anything, throwing wherever load() would:
+	static void check(ByteReader *from);
+
+	//------- internals -------
+
+	static constexpr uint32_t SlotBits = 6;
+	static constexpr uint32_t Slots = 1 << SlotBits;
+	static constexpr uint32_t Levels = 4; //(timers further out than 64^4 ticks take a lap at the top level)
+
+	struct Timer {
+		uint64_t due = 0;
+		uint32_t next = -1U, prev = -1U; //(doubly-linked list in a slot)
+		uint32_t slot = -1U; //level * Slots + slot, Firing, or -1U if free
+		uint32_t generation = 0;
+		Payload payload;
+	};
+	std::vector< Timer > timers;
+	std::vector< uint32_t > free_timers;
+	static constexpr uint32_t Firing = Levels * Slots; //(the list of timers firing right now)
+	uint32_t heads[Levels * Slots + 1]; //first timer in each slot (or -1U)
+
+	void link(uint32_t index); //put a timer into the slot for its due tick
+	void unlink(uint32_t index);
+	uint32_t take_slot(uint32_t slot); //empty a slot, returning its old list
+};
+
+template< typename Payload >
+void TimerWheel< Payload >::clear(uint64_t at) {
+	now = at;
+	timers.clear();
+	free_timers.clear();
+	for (uint32_t &head : heads) head = -1U;
+}
+
+template< typename Payload >
+typename TimerWheel< Payload >::Handle TimerWheel< Payload >::schedule(uint64_t due, Payload const &payload) {
+	uint32_t index;
+	if (!free_timers.empty()) {
+		index = free_timers.back();
+		free_timers.pop_back();
+	} else {
+		index = uint32_t(timers.size());
+		timers.emplace_back();
+	}
+	Timer &timer = timers[index];
+	timer.due = (due > now ? due : now + 1);
+	timer.payload = payload;
+	link(index);
+
+	Handle handle;
+	handle.index = index;
+	handle.generation = timer.generation;
+	return handle;
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::cancel(Handle handle) {
+	if (!pending(handle)) return;
+	unlink(handle.index);
+	timers[handle.index].generation += 1;
+	free_timers.emplace_back(handle.index);
+}
+
+template< typename Payload >
+template< typename F >
+void TimerWheel< Payload >::advance(uint64_t to, F &&fire) {
+	while (now < to) {
+		now += 1;
+
+		//when the ticks below a level wrap around, its current slot drops down a level
+		// (higher levels first, since their timers may land in the lower slots):
+		uint32_t top = 0;
+		while (top + 1 < Levels && (now & ((uint64_t(1) << (SlotBits * (top + 1))) - 1)) == 0) ++top;
+		for (uint32_t level = top; level >= 1; --level) {
+			uint32_t index = take_slot(level * Slots + uint32_t(now >> (SlotBits * level)) % Slots);
+			while (index != -1U) {
+				uint32_t next = timers[index].next;
+				link(index);
+				index = next;
+			}
+		}
+
+		//(due timers wait in their own list, so that fire() can cancel them like any other)
+		uint32_t slot = uint32_t(now % Slots);
+		heads[Firing] = heads[slot];
+		heads[slot] = -1U;
+		for (uint32_t i = heads[Firing]; i != -1U; i = timers[i].next) {
+			timers[i].slot = Firing;
+		}
+		while (heads[Firing] != -1U) {
+			uint32_t index = heads[Firing];
+			unlink(index);
+			if (timers[index].due > now) {
+				link(index); //(came around the top level early)
+				continue;
+			}
+			Payload payload = timers[index].payload;
+			timers[index].generation += 1;
+			free_timers.emplace_back(index);
+			fire(static_cast< Payload const & >(payload)); //(may reuse 'index')
+		}
+	}
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::link(uint32_t index) {
+	Timer &timer = timers[index];
+	//the lowest level whose span (from 'now') reaches the due tick:
+	uint32_t level = 0;
+	while (level + 1 < Levels && ((timer.due ^ now) >> (SlotBits * (level + 1))) != 0) ++level;
+	uint32_t slot = level * Slots + uint32_t(timer.due >> (SlotBits * level)) % Slots;
+
+	timer.slot = slot;
+	timer.prev = -1U;
+	timer.next = heads[slot];
+	if (timer.next != -1U) timers[timer.next].prev = index;
+	heads[slot] = index;
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::unlink(uint32_t index) {
+	Timer &timer = timers[index];
+	assert(timer.slot != -1U);
+	if (timer.prev != -1U) timers[timer.prev].next = timer.next;
+	else heads[timer.slot] = timer.next;
+	if (timer.next != -1U) timers[timer.next].prev = timer.prev;
+	timer.slot = -1U;
+}
+
+template< typename Payload >
+uint32_t TimerWheel< Payload >::take_slot(uint32_t slot) {
+	uint32_t index = heads[slot];
+	heads[slot] = -1U;
+	for (uint32_t i = index; i != -1U; i = timers[i].next) {
+		timers[i].slot = -1U;
+	}
+	return index;
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::save(std::vector< uint8_t > *_to) const {
+	uint32_t counts[2] = { uint32_t(timers.size()), uint32_t(free_timers.size()) };
+	write_bytes(_to, &now, 1);
+	write_bytes(_to, counts, 2);
+	write_bytes(_to, timers.data(), timers.size());
+	write_bytes(_to, free_timers.data(), free_timers.size());
+	write_bytes(_to, heads, Levels * Slots + 1);
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::check(ByteReader *_from) {
+	assert(_from);
+	uint64_t saved_now;
+	uint32_t counts[2];
+	_from->read(&saved_now, 1);
+	_from->read(counts, 2);
+	uint8_t const *saved_timers = _from->skip(size_t(counts[0]) * sizeof(Timer));
+
+	//(a bad index would corrupt memory later, so check them all now)
+	auto bad = [&counts](uint32_t index) { return index != -1U && index >= counts[0]; };
+	bool malformed = (counts[1] > counts[0]);
+	for (uint32_t i = 0; i < counts[0] && !malformed; ++i) {
+		Timer timer;
+		std::memcpy(static_cast< void * >(&timer), saved_timers + i * sizeof(Timer), sizeof(Timer));
+		malformed = bad(timer.next) || bad(timer.prev) || (timer.slot != -1U && timer.slot >= Firing);
+	}
+	for (uint32_t i = 0; i < counts[1] && !malformed; ++i) {
+		uint32_t index;
+		_from->read(&index, 1);
+		malformed = (index >= counts[0]);
+	}
+	uint32_t saved_heads[Levels * Slots + 1];
+	if (!malformed) {
+		_from->read(saved_heads, Levels * Slots + 1);
+		malformed = (saved_heads[Firing] != -1U);
+		for (uint32_t head : saved_heads) malformed = malformed || bad(head);
+	}
+	if (malformed) {
+		throw std::runtime_error("Timer wheel snapshot is malformed.");
+	}
+}
+
+template< typename Payload >
+void TimerWheel< Payload >::load(ByteReader *_from) {
+	assert(_from);
+	ByteReader ahead = *_from;
+	check(&ahead);
+
+	uint32_t counts[2];
+	_from->read(&now, 1);
+	_from->read(counts, 2);
+	timers.resize(counts[0]);
+	_from->read(timers.data(), timers.size());
+	free_timers.resize(counts[1]);
+	_from->read(free_timers.data(), free_timers.size());
+	_from->read(heads, Levels * Slots + 1);
+}
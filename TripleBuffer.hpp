@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//TripleBuffer hands values from one producer thread to one consumer thread
+// without locks: the producer always has a buffer to write into, the consumer
+// always has the most recently published buffer to read from, and the third
+// buffer sits in the middle waiting to be swapped by either side.
+//Buffers are reused, so (e.g.) vectors inside T keep their capacity.
+
+template< typename T >
+struct TripleBuffer {
+	//---- producer side ----
+	T &write_buffer() { return buffers[write_index]; }
+
+	//make the write buffer available to the consumer (replacing any unconsumed one):
+	void publish() {
+		uint8_t old = middle.exchange(uint8_t(write_index | Fresh), std::memory_order_acq_rel);
+		write_index = uint8_t(old & IndexMask);
+	}
+
+	//has the consumer picked up the last published buffer?
+	bool consumed() const {
+		return (middle.load(std::memory_order_acquire) & Fresh) == 0;
+	}
+
+	//---- consumer side ----
+
+	//swap in the most recently published buffer; returns false if nothing new was published:
+	bool acquire() {
+		if ((middle.load(std::memory_order_acquire) & Fresh) == 0) return false;
+		uint8_t old = middle.exchange(read_index, std::memory_order_acq_rel);
+		read_index = uint8_t(old & IndexMask);
+		return true;
+	}
+
+	T const &read_buffer() const { return buffers[read_index]; }
+
+private:
+	enum : uint8_t { IndexMask = 0x3, Fresh = 0x4 };
+
+	T buffers[3];
+	uint8_t write_index = 0; //owned by producer
+	std::atomic< uint8_t > middle{uint8_t(1)}; //index of middle buffer | Fresh
+	uint8_t read_index = 2; //owned by consumer
+};
@@ -0,0 +1,305 @@
+#include "World.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+	struct ComponentInfo {
+		uint32_t size;
+		uint32_t alignment;
+	};
+	std::mutex registry_mutex;
+	std::vector< ComponentInfo > &registry() {
+		static std::vector< ComponentInfo > components;
+		return components;
+	}
+}
+
+uint32_t World::register_component(uint32_t size, uint32_t alignment) {
+	std::lock_guard< std::mutex > lock(registry_mutex);
+	if (registry().size() >= MaxComponents) {
+		throw std::runtime_error("World supports at most 32 component types.");
+	}
+	registry().emplace_back(ComponentInfo{size, alignment});
+	return uint32_t(registry().size() - 1);
+}
+
+uint32_t World::archetype_for(Mask mask) {
+	for (uint32_t a = 0; a < archetypes.size(); ++a) {
+		if (archetypes[a]->mask == mask) return a;
+	}
+
+	//(a component id that was never registered would read past the registry below)
+	{
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		uint32_t registered = uint32_t(registry().size());
+		if (registered < MaxComponents && (mask >> registered) != 0) {
+			throw std::runtime_error("Archetype mask has an unregistered component.");
+		}
+	}
+
+	std::unique_ptr< Archetype > archetype(new Archetype);
+	archetype->mask = mask;
+
+	std::vector< ComponentInfo > infos(MaxComponents, ComponentInfo{0, 1});
+	uint32_t row_bytes = sizeof(Entity);
+	uint32_t slack = 0; //(worst-case padding between arrays)
+	{
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		for (uint32_t id = 0; id < MaxComponents; ++id) {
+			if (!(mask & (Mask(1) << id))) continue;
+			infos[id] = registry()[id];
+			row_bytes += infos[id].size;
+			slack += infos[id].alignment;
+		}
+	}
+
+	//as many rows as fit in a chunk (at least one):
+	archetype->capacity = std::max(1U, (uint32_t(ChunkBytes) - std::min(slack, uint32_t(ChunkBytes))) / row_bytes);
+
+	uint32_t offset = 0;
+	archetype->columns.emplace_back(Archetype::Column{offset, uint32_t(sizeof(Entity))});
+	offset += archetype->capacity * uint32_t(sizeof(Entity));
+	for (uint32_t id = 0; id < MaxComponents; ++id) {
+		archetype->offsets[id] = -1U;
+		if (!(mask & (Mask(1) << id))) continue;
+		offset = (offset + infos[id].alignment - 1) / infos[id].alignment * infos[id].alignment;
+		archetype->offsets[id] = offset;
+		archetype->columns.emplace_back(Archetype::Column{offset, infos[id].size});
+		offset += archetype->capacity * infos[id].size;
+	}
+	archetype->chunk_bytes = offset;
+
+	archetypes.emplace_back(std::move(archetype));
+	return uint32_t(archetypes.size() - 1);
+}
+
+uint32_t World::Archetype::push_row() {
+	uint32_t row = size;
+	if (row / capacity == chunks.size()) {
+		chunks.emplace_back();
+		//(operator new[] alignment covers every component that doesn't over-align past 16 bytes)
+		chunks.back().data.reset(new uint8_t[chunk_bytes]);
+	}
+	chunks[row / capacity].count += 1;
+	size += 1;
+	return row;
+}
+
+void World::Archetype::remove_row(uint32_t row, std::vector< Record > *_records) {
+	assert(_records);
+	assert(row < size);
+	uint32_t last = size - 1;
+	Chunk &to = chunks[row / capacity];
+	Chunk &from = chunks[last / capacity];
+	if (row != last) {
+		uint32_t to_slot = row % capacity;
+		uint32_t from_slot = last % capacity;
+		for (Column const &column : columns) {
+			std::memcpy(to.data.get() + column.offset + to_slot * column.size, from.data.get() + column.offset + from_slot * column.size, column.size);
+		}
+		(*_records)[entities(to)[to_slot].index].row = row;
+	}
+	from.count -= 1;
+	size -= 1;
+}
+
+void World::reserve(uint32_t count) {
+	records.reserve(count);
+	free_indices.reserve(count);
+	destroyed.reserve(count);
+}
+
+void World::destroy(Entity entity) {
+	destroyed.emplace_back(entity);
+}
+
+void World::flush() {
+	for (Entity entity : destroyed) {
+		if (!alive(entity)) continue; //(destroyed twice)
+		Record &record = records[entity.index];
+		archetypes[record.archetype]->remove_row(record.row, &records);
+		record.archetype = -1U;
+		record.generation += 1;
+		free_indices.emplace_back(entity.index);
+	}
+	destroyed.clear();
+}
+
+void World::clear() {
+	for (auto &archetype : archetypes) {
+		for (Chunk &chunk : archetype->chunks) {
+			chunk.count = 0;
+		}
+		archetype->size = 0;
+	}
+	free_indices.clear();
+	for (uint32_t i = uint32_t(records.size()); i > 0; --i) {
+		Record &record = records[i - 1];
+		if (record.archetype != -1U) {
+			record.archetype = -1U;
+			record.generation += 1;
+		}
+		free_indices.emplace_back(i - 1);
+	}
+	destroyed.clear();
+}
+
+bool World::alive(Entity entity) const {
+	return entity.index < records.size()
+		&& records[entity.index].archetype != -1U
+		&& records[entity.index].generation == entity.generation;
+}
+
+void World::save(std::vector< uint8_t > *_to) const {
+	assert(_to);
+	uint32_t counts[3] = { uint32_t(records.size()), uint32_t(free_indices.size()), uint32_t(archetypes.size()) };
+	write_bytes(_to, counts, 3);
+	write_bytes(_to, records.data(), records.size());
+	write_bytes(_to, free_indices.data(), free_indices.size());
+	for (auto const &archetype : archetypes) {
+		write_bytes(_to, &archetype->mask, 1);
+		write_bytes(_to, &archetype->size, 1);
+		//each chunk's arrays are saved as-is, trimmed to the rows in use:
+		for (Chunk const &chunk : archetype->chunks) {
+			if (chunk.count == 0) break;
+			for (Archetype::Column const &column : archetype->columns) {
+				write_bytes(_to, chunk.data.get() + column.offset, chunk.count * column.size);
+			}
+		}
+	}
+}
+
+void World::check(ByteReader *_from) {
+	assert(_from);
+	ByteReader &from = *_from;
+
+	uint32_t counts[3];
+	from.read(counts, 3);
+	Record const *saved_records = reinterpret_cast< Record const * >(from.skip(size_t(counts[0]) * sizeof(Record)));
+	for (uint32_t i = 0; i < counts[1]; ++i) {
+		uint32_t index;
+		from.read(&index, 1);
+		Record record;
+		if (index < counts[0]) std::memcpy(&record, saved_records + index, sizeof(Record));
+		if (index >= counts[0] || record.archetype != -1U) {
+			throw std::runtime_error("Snapshot has a bad free entity index.");
+		}
+	}
+
+	if (size_t(from.end - from.at) / (sizeof(Mask) + sizeof(uint32_t)) < counts[2]) {
+		throw std::runtime_error("Snapshot data is truncated.");
+	}
+	std::vector< Mask > masks(counts[2]);
+	std::vector< uint32_t > sizes(counts[2]);
+	for (uint32_t a = 0; a < counts[2]; ++a) {
+		from.read(&masks[a], 1);
+		from.read(&sizes[a], 1);
+		//(load() renumbers this world's archetypes to match, so masks only need to be
+		// distinct and made of registered components)
+		if (std::find(masks.begin(), masks.begin() + a, masks[a]) != masks.begin() + a) {
+			throw std::runtime_error("Archetype masks repeat.");
+		}
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		uint32_t registered = uint32_t(registry().size());
+		if (registered < MaxComponents && (masks[a] >> registered) != 0) {
+			throw std::runtime_error("Archetype mask has an unregistered component.");
+		}
+		uint32_t row_bytes = sizeof(Entity);
+		for (uint32_t id = 0; id < MaxComponents; ++id) {
+			if (masks[a] & (Mask(1) << id)) row_bytes += registry()[id].size;
+		}
+		from.skip(size_t(sizes[a]) * row_bytes);
+	}
+
+	for (uint32_t i = 0; i < counts[0]; ++i) {
+		Record record;
+		std::memcpy(&record, saved_records + i, sizeof(Record));
+		if (record.archetype != -1U && (record.archetype >= counts[2] || record.row >= sizes[record.archetype])) {
+			throw std::runtime_error("Snapshot has an entity outside its archetype.");
+		}
+	}
+}
+
+void World::load(ByteReader *_from) {
+	assert(_from);
+	ByteReader &from = *_from;
+
+	uint32_t counts[3];
+	from.read(counts, 3);
+	records.resize(counts[0]);
+	from.read(records.data(), records.size());
+	free_indices.resize(counts[1]);
+	from.read(free_indices.data(), free_indices.size());
+	destroyed.clear();
+
+	for (uint32_t a = 0; a < counts[2]; ++a) {
+		Mask mask;
+		uint32_t size;
+		from.read(&mask, 1);
+		from.read(&size, 1);
+		Archetype &archetype = archetype_at(a, mask, size);
+		for (Chunk &chunk : archetype.chunks) {
+			for (Archetype::Column const &column : archetype.columns) {
+				std::memcpy(chunk.data.get() + column.offset, from.skip(chunk.count * column.size), chunk.count * column.size);
+			}
+		}
+	}
+	//(archetypes made since the save are empty)
+	for (uint32_t a = counts[2]; a < archetypes.size(); ++a) {
+		archetype_at(a, archetypes[a]->mask, 0);
+	}
+
+	for (Record const &record : records) {
+		if (record.archetype != -1U && (record.archetype >= counts[2] || record.row >= archetypes[record.archetype]->size)) {
+			throw std::runtime_error("Snapshot has an entity outside of its archetypes.");
+		}
+	}
+}
+
+void World::copy_from(World const &from) {
+	if (&from == this) return;
+	records = from.records; //(vector assignment reuses storage)
+	free_indices = from.free_indices;
+	destroyed = from.destroyed;
+	for (uint32_t a = 0; a < from.archetypes.size(); ++a) {
+		Archetype const &source = *from.archetypes[a];
+		Archetype &archetype = archetype_at(a, source.mask, source.size);
+		for (uint32_t c = 0; c < archetype.chunks.size(); ++c) {
+			Chunk &chunk = archetype.chunks[c];
+			if (chunk.count == 0) break;
+			for (Archetype::Column const &column : archetype.columns) {
+				std::memcpy(chunk.data.get() + column.offset, source.chunks[c].data.get() + column.offset, chunk.count * column.size);
+			}
+		}
+	}
+	for (uint32_t a = uint32_t(from.archetypes.size()); a < archetypes.size(); ++a) {
+		archetype_at(a, archetypes[a]->mask, 0);
+	}
+}
+
+World::Archetype &World::archetype_at(uint32_t a, Mask mask, uint32_t size) {
+	//archetypes are numbered in the order they were made, so worlds that have seen the
+	// same kinds of entity agree; if not, this world's are renumbered to match:
+	if (a < archetypes.size() && archetypes[a]->mask != mask) {
+		archetypes.resize(a);
+		layout_version += 1;
+	}
+	if (a == archetypes.size()) {
+		uint32_t made = archetype_for(mask);
+		if (made != a) throw std::runtime_error("Archetype masks repeat.");
+	}
+	assert(a < archetypes.size());
+
+	Archetype &archetype = *archetypes[a];
+	archetype.size = size;
+	for (uint32_t c = 0; c < archetype.chunks.size() || c * archetype.capacity < size; ++c) {
+		if (c == archetype.chunks.size()) {
+			archetype.chunks.emplace_back();
+			archetype.chunks.back().data.reset(new uint8_t[archetype.chunk_bytes]);
+		}
+		archetype.chunks[c].count = std::min(archetype.capacity, size - std::min(size, c * archetype.capacity));
+	}
+	return archetype;
+}
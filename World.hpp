@@ -0,0 +1,239 @@
+#pragma once
+
+#include "byte_stream.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+//World is a small archetype-based entity-component store.
+//
+//Components are plain (trivially copyable) structs. Entities with the same set of
+// components share an archetype, which stores them in fixed-size chunks; each chunk
+// holds one tightly packed array per component, so systems walk contiguous memory:
+//
+//   World world;
+//   World::Entity e = world.create(Position{...}, Heading{...});
+//   World::Query< Position, Heading > moving; //(remembers which archetypes match)
+//   moving.each(world, [](World::Entity e, Position &p, Heading &h) { ... });
+//
+//destroy() is deferred until flush(), so systems may destroy entities while iterating.
+//Creating entities while iterating a query is not allowed (chunks may be added).
+
+struct World {
+	struct Entity {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+		bool operator==(Entity const &other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(Entity const &other) const { return !(*this == other); }
+	};
+
+	World() = default;
+
+	template< typename... Components >
+	Entity create(Components const &... components);
+
+	//make room for 'count' entities without reallocating the bookkeeping:
+	void reserve(uint32_t count);
+
+	void destroy(Entity entity); //(takes effect at the next flush())
+	void flush();
+	void clear(); //destroy every entity immediately (storage stays allocated)
+
+	bool alive(Entity entity) const;
+	uint32_t size() const { return uint32_t(records.size() - free_indices.size()); } //(live entities)
+
+	//returns nullptr if 'entity' is dead or doesn't have the component:
+	template< typename T >
+	T *get(Entity entity);
+
+	template< typename... Components >
+	struct Query;
+
+	//------- snapshots -------
+
+	//append every entity (with its components) to '_to' as raw bytes; takes time
+	// proportional to the number of entities (pending destroy()s are not saved):
+	void save(std::vector< uint8_t > *_to) const;
+	//replace every entity with those in a save() made by this program; entity handles
+	// from the time of the save are valid again. Storage is reused, so loading a world of
+	// no more entities than this one has held doesn't allocate. Throws if malformed:
+	void load(ByteReader *from);
+	//read past a save() without changing anything, throwing wherever load() would (and on
+	// free indices that aren't free), so a load can't fail halfway:
+	static void check(ByteReader *from);
+
+	//replace every entity with a copy of those in 'from' (reusing storage, like load()):
+	void copy_from(World const &from);
+
+	//------- internals -------
+
+	typedef uint32_t Mask; //one bit per component type
+	static constexpr uint32_t MaxComponents = 32;
+	static constexpr uint32_t ChunkBytes = 16 * 1024;
+
+	//component types get small ids the first time they are used:
+	template< typename T >
+	static uint32_t component_id() {
+		static_assert(std::is_trivially_copyable< T >::value, "Components are moved with memcpy.");
+		static uint32_t const id = register_component(sizeof(T), alignof(T));
+		return id;
+	}
+	static uint32_t register_component(uint32_t size, uint32_t alignment);
+
+	template< typename... Components >
+	static Mask mask_of() {
+		Mask mask = 0;
+		int expand[] = { 0, (mask |= Mask(1) << component_id< Components >(), 0)... };
+		(void)expand;
+		return mask;
+	}
+
+	static uint32_t mask_size(Mask mask) {
+		uint32_t size = 0;
+		for (; mask; mask &= mask - 1) ++size;
+		return size;
+	}
+
+	struct Record {
+		uint32_t archetype = -1U; //-1U if the index is free
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+
+	struct Chunk {
+		std::unique_ptr< uint8_t[] > data;
+		uint32_t count = 0;
+	};
+
+	struct Archetype {
+		Mask mask = 0;
+		uint32_t capacity = 0; //rows per chunk
+		uint32_t chunk_bytes = 0;
+		uint32_t offsets[MaxComponents]; //start of each component's array in a chunk (by id)
+		struct Column {
+			uint32_t offset;
+			uint32_t size;
+		};
+		std::vector< Column > columns; //every array, entity ids first
+		std::vector< Chunk > chunks; //(rows fill chunks in order, so only the last is partial)
+		uint32_t size = 0; //rows in use
+
+		Entity *entities(Chunk &chunk) const { return reinterpret_cast< Entity * >(chunk.data.get()); }
+		template< typename T >
+		T *column(Chunk &chunk) const {
+			assert(mask & (Mask(1) << component_id< T >()));
+			return reinterpret_cast< T * >(chunk.data.get() + offsets[component_id< T >()]);
+		}
+
+		uint32_t push_row();
+		void remove_row(uint32_t row, std::vector< Record > *records); //(moves the last row into the hole)
+	};
+
+	std::vector< std::unique_ptr< Archetype > > archetypes; //(only appended to, except by load()/copy_from())
+	std::vector< Record > records; //by entity index
+	std::vector< uint32_t > free_indices;
+	std::vector< Entity > destroyed;
+	uint32_t layout_version = 0; //incremented when archetypes are renumbered (queries then re-scan)
+
+	uint32_t archetype_for(Mask mask); //find or make (throws if a component in it isn't registered)
+
+	//archetype 'a' with 'mask', renumbering archetypes from 'a' on if needed, and
+	// sized to hold 'size' rows (used by load() and copy_from()):
+	Archetype &archetype_at(uint32_t a, Mask mask, uint32_t size);
+};
+
+//Query caches the archetypes that have all of 'Components'; it only re-scans
+// archetypes added since it last ran:
+template< typename... Components >
+struct World::Query {
+	Mask mask = mask_of< Components... >();
+	uint32_t layout_version = 0;
+	uint32_t archetypes_seen = 0;
+	std::vector< uint32_t > matches;
+
+	void refresh(World const &world) {
+		if (layout_version != world.layout_version) {
+			layout_version = world.layout_version;
+			archetypes_seen = 0;
+			matches.clear();
+		}
+		for (; archetypes_seen < world.archetypes.size(); ++archetypes_seen) {
+			if ((world.archetypes[archetypes_seen]->mask & mask) == mask) matches.emplace_back(archetypes_seen);
+		}
+	}
+
+	//call f(count, entities, arrays...) for each chunk of matching entities:
+	template< typename F >
+	void each_chunk(World &world, F &&f) {
+		refresh(world);
+		for (uint32_t a : matches) {
+			Archetype &archetype = *world.archetypes[a];
+			for (Chunk &chunk : archetype.chunks) {
+				if (chunk.count == 0) break;
+				f(chunk.count, archetype.entities(chunk), archetype.template column< Components >(chunk)...);
+			}
+		}
+	}
+
+	//call f(entity, components...) for each matching entity:
+	template< typename F >
+	void each(World &world, F &&f) {
+		each_chunk(world, [&f](uint32_t count, Entity const *entities, Components *... arrays) {
+			for (uint32_t i = 0; i < count; ++i) {
+				f(entities[i], arrays[i]...);
+			}
+		});
+	}
+
+	uint32_t count(World &world) {
+		refresh(world);
+		uint32_t total = 0;
+		for (uint32_t a : matches) total += world.archetypes[a]->size;
+		return total;
+	}
+};
+
+template< typename... Components >
+World::Entity World::create(Components const &... components) {
+	Mask mask = mask_of< Components... >();
+	assert(mask_size(mask) == sizeof...(Components) && "Components must be distinct.");
+
+	uint32_t a = archetype_for(mask);
+	Archetype &archetype = *archetypes[a];
+	uint32_t row = archetype.push_row();
+
+	Entity entity;
+	if (!free_indices.empty()) {
+		entity.index = free_indices.back();
+		free_indices.pop_back();
+	} else {
+		entity.index = uint32_t(records.size());
+		records.emplace_back();
+	}
+	Record &record = records[entity.index];
+	entity.generation = record.generation;
+	record.archetype = a;
+	record.row = row;
+
+	Chunk &chunk = archetype.chunks[row / archetype.capacity];
+	uint32_t slot = row % archetype.capacity;
+	archetype.entities(chunk)[slot] = entity;
+	int expand[] = { 0, (archetype.template column< Components >(chunk)[slot] = components, 0)... };
+	(void)expand;
+
+	return entity;
+}
+
+template< typename T >
+T *World::get(Entity entity) {
+	if (!alive(entity)) return nullptr;
+	Record const &record = records[entity.index];
+	Archetype &archetype = *archetypes[record.archetype];
+	if (!(archetype.mask & (Mask(1) << component_id< T >()))) return nullptr;
+	Chunk &chunk = archetype.chunks[record.row / archetype.capacity];
+	return &archetype.template column< T >(chunk)[record.row % archetype.capacity];
+}
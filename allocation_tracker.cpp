@@ -0,0 +1,92 @@
+#include "allocation_tracker.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	struct ZoneTotals {
+		std::atomic< uint64_t > allocations;
+		std::atomic< uint64_t > bytes;
+	};
+	ZoneTotals totals[AllocationZones]; //(zero-initialized: static storage)
+	thread_local AllocationZoneId current_zone = ZoneOther;
+
+	void *tracked_allocate(std::size_t size) {
+		ZoneTotals &zone = totals[current_zone];
+		zone.allocations.fetch_add(1, std::memory_order_relaxed);
+		zone.bytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+}
+
+AllocationCounts allocation_counts(AllocationZoneId zone) {
+	AllocationCounts counts;
+	counts.allocations = totals[zone].allocations.load(std::memory_order_relaxed);
+	counts.bytes = totals[zone].bytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+char const *allocation_zone_name(AllocationZoneId zone) {
+	switch (zone) {
+		case ZoneOther: return "other";
+		case ZoneUpdate: return "update";
+		case ZoneDraw: return "draw";
+		case ZoneRender: return "render";
+		default: return "?";
+	}
+}
+
+AllocationZone::AllocationZone(AllocationZoneId zone) : previous(current_zone) {
+	current_zone = zone;
+}
+
+AllocationZone::~AllocationZone() {
+	current_zone = previous;
+}
+
+//------- replacement global allocation functions -------
+
+void *operator new(std::size_t size) {
+	void *ret = tracked_allocate(size);
+	if (!ret) throw std::bad_alloc();
+	return ret;
+}
+
+void *operator new[](std::size_t size) {
+	void *ret = tracked_allocate(size);
+	if (!ret) throw std::bad_alloc();
+	return ret;
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept {
+	return tracked_allocate(size);
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept {
+	return tracked_allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::nothrow_t const &) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::nothrow_t const &) noexcept {
+	std::free(ptr);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+//Counts heap allocations (by replacing the global operator new) and attributes
+// each one to the zone the allocating thread was in at the time:
+//   { AllocationZone zone(ZoneUpdate); game->update(elapsed, ticks); }
+//Counting costs two relaxed atomic adds per allocation, so it is always on.
+
+enum AllocationZoneId : uint32_t {
+	ZoneOther = 0, //(outside any zone)
+	ZoneUpdate,
+	ZoneDraw,
+	ZoneRender,
+	AllocationZones
+};
+
+struct AllocationCounts {
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+};
+
+//totals for 'zone' since the program started:
+AllocationCounts allocation_counts(AllocationZoneId zone);
+char const *allocation_zone_name(AllocationZoneId zone);
+
+//the current thread's allocations count toward 'zone' while this is in scope:
+struct AllocationZone {
+	AllocationZone(AllocationZoneId zone);
+	~AllocationZone();
+	AllocationZoneId previous;
+};
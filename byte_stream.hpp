@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+//Helpers for flat binary snapshots of trivially copyable data:
+//   std::vector< uint8_t > bytes;
+//   write_bytes(&bytes, &header, 1);
+//   ByteReader in(bytes.data(), bytes.size());
+//   in.read(&header, 1);
+
+template< typename T >
+void write_bytes(std::vector< uint8_t > *_to, T const *data, size_t count) {
+	static_assert(std::is_trivially_copyable< T >::value, "Only trivially copyable data can be written as bytes.");
+	assert(_to);
+	if (count == 0) return;
+	size_t at = _to->size();
+	_to->resize(at + count * sizeof(T));
+	std::memcpy(_to->data() + at, data, count * sizeof(T));
+}
+
+struct ByteReader {
+	ByteReader(uint8_t const *_begin, size_t size) : at(_begin), end(_begin + size) { }
+
+	template< typename T >
+	void read(T *_to, size_t count) {
+		static_assert(std::is_trivially_copyable< T >::value, "Only trivially copyable data can be read as bytes.");
+		assert(_to || count == 0);
+		if (count == 0) return;
+		if (size_t(end - at) / sizeof(T) < count) {
+			throw std::runtime_error("Snapshot data is truncated.");
+		}
+		std::memcpy(_to, at, count * sizeof(T));
+		at += count * sizeof(T);
+	}
+
+	//the next 'bytes' bytes, in place:
+	uint8_t const *skip(size_t bytes) {
+		if (size_t(end - at) < bytes) {
+			throw std::runtime_error("Snapshot data is truncated.");
+		}
+		uint8_t const *ret = at;
+		at += bytes;
+		return ret;
+	}
+
+	uint8_t const *at;
+	uint8_t const *end;
+};
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <cstdlib>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -12,6 +13,7 @@
 #include <io.h>
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
+#include <sys/stat.h>
 #elif defined(__linux__)
 #include <unistd.h>
 #include <sys/stat.h>
@@ -71,3 +73,44 @@ std::string data_path(std::string const &suffix) {
 	static std::string path = get_data_path();
 	return path + "/" + suffix;
 }
+
+//get_user_path() gets (and makes, if needed) a per-user directory for this game's files:
+
+static std::string get_user_path() {
+	std::string ret;
+	#if defined(_WIN32)
+	PWSTR path = nullptr;
+	if (SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &path) == S_OK) {
+		std::wstring wide = path;
+		for (wchar_t c : wide) ret += char(c); //(assumes the path is ASCII)
+	}
+	CoTaskMemFree(path);
+	if (ret.empty()) return get_data_path();
+	ret += "\\egg-hoarder";
+	_mkdir(ret.c_str());
+
+	#elif defined(__linux__)
+	//From: https://specifications.freedesktop.org/basedir-spec/basedir-spec-latest.html
+	char const *config = std::getenv("XDG_CONFIG_HOME");
+	char const *home = std::getenv("HOME");
+	if (config && config[0]) ret = config;
+	else if (home && home[0]) ret = std::string(home) + "/.config";
+	else return get_data_path();
+	mkdir(ret.c_str(), 0755);
+	ret += "/egg-hoarder";
+	mkdir(ret.c_str(), 0755);
+
+	#elif defined(__APPLE__)
+	char const *home = std::getenv("HOME");
+	if (!home || !home[0]) return get_data_path();
+	ret = std::string(home) + "/Library/Application Support/egg-hoarder";
+	mkdir(ret.c_str(), 0755);
+	#endif
+
+	return ret;
+}
+
+std::string user_path(std::string const &suffix) {
+	static std::string path = get_user_path();
+	return path + "/" + suffix;
+}
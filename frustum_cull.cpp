@@ -0,0 +1,42 @@
+#include "frustum_cull.hpp"
+
+size_t frustum_cull(glm::mat4 const &world_to_clip, size_t count,
+	float const *x, float const *y, float const *z, float const *radius,
+	uint8_t *visible) {
+
+	//extract the six clip planes (Gribb & Hartmann); glm matrices are column-major,
+	// so row i of world_to_clip is (m[0][i], m[1][i], m[2][i], m[3][i]):
+	glm::mat4 const &m = world_to_clip;
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i) {
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+	glm::vec4 planes[6] = {
+		row[3] + row[0], row[3] - row[0], //left, right
+		row[3] + row[1], row[3] - row[1], //bottom, top
+		row[3] + row[2], row[3] - row[2], //near, far
+	};
+	//normalize so that plane distances can be compared against radii:
+	for (auto &p : planes) {
+		float len = glm::length(glm::vec3(p));
+		if (len > 0.0f) p /= len;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		visible[i] = 1;
+	}
+
+	for (auto const &p : planes) {
+		float const a = p.x, b = p.y, c = p.z, d = p.w;
+		for (size_t i = 0; i < count; ++i) {
+			float dist = a * x[i] + b * y[i] + c * z[i] + d;
+			visible[i] &= uint8_t(dist >= -radius[i]);
+		}
+	}
+
+	size_t total = 0;
+	for (size_t i = 0; i < count; ++i) {
+		total += visible[i];
+	}
+	return total;
+}
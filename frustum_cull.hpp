@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+//frustum_cull tests a batch of world-space bounding spheres against the
+// frustum described by a world_to_clip matrix.
+//Spheres are passed as separate (structure-of-arrays) x/y/z/radius arrays
+// so that the per-plane loop can be vectorized by the compiler.
+//visible[i] is set to 1 if sphere i may intersect the frustum, 0 otherwise.
+//Returns the number of visible spheres.
+size_t frustum_cull(glm::mat4 const &world_to_clip, size_t count,
+	float const *x, float const *y, float const *z, float const *radius,
+	uint8_t *visible);
@@ -0,0 +1,76 @@
+#include "gl_features.hpp"
+
+#include <SDL.h>
+
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+GLFeatures gl_features;
+
+SDL_GLContext create_best_gl_context(SDL_Window *window) {
+	//newest first; 3.3 is what the fallback paths are written against:
+	static int const versions[][2] = {
+		{4,6}, {4,5}, {4,4}, {4,3}, {4,2}, {4,1}, {4,0}, {3,3}
+	};
+	for (auto const &version : versions) {
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version[0]);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version[1]);
+		SDL_GLContext context = SDL_GL_CreateContext(window);
+		if (context) return context;
+	}
+	return nullptr;
+}
+
+void init_gl_features() {
+	gl_features = GLFeatures();
+
+	glGetIntegerv(GL_MAJOR_VERSION, &gl_features.major);
+	glGetIntegerv(GL_MINOR_VERSION, &gl_features.minor);
+
+	//read the extension list once instead of searching it per-query:
+	std::unordered_set< std::string > extensions;
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		char const *name = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, i));
+		if (name) extensions.emplace(name);
+	}
+	auto has = [&](char const *name) {
+		return extensions.count(name) != 0;
+	};
+
+	//look up an entry point, clearing 'flag' if it is missing:
+	auto get = [](bool *flag, char const *name) -> void * {
+		if (!*flag) return nullptr;
+		void *proc = SDL_GL_GetProcAddress(name);
+		if (!proc) *flag = false;
+		return proc;
+	};
+
+	gl_features.buffer_storage = gl_features.version_at_least(4,4) || has("GL_ARB_buffer_storage");
+	gl_features.BufferStorage = reinterpret_cast< PFNGLBUFFERSTORAGEPROC >(get(&gl_features.buffer_storage, "glBufferStorage"));
+
+	gl_features.multi_draw_indirect = gl_features.version_at_least(4,3)
+		|| (has("GL_ARB_multi_draw_indirect") && (gl_features.version_at_least(4,2) || has("GL_ARB_base_instance")));
+	gl_features.MultiDrawArraysIndirect = reinterpret_cast< PFNGLMULTIDRAWARRAYSINDIRECTPROC >(get(&gl_features.multi_draw_indirect, "glMultiDrawArraysIndirect"));
+
+	gl_features.direct_state_access = gl_features.version_at_least(4,5) || has("GL_ARB_direct_state_access");
+	gl_features.NamedBufferData = reinterpret_cast< PFNGLNAMEDBUFFERDATAPROC >(get(&gl_features.direct_state_access, "glNamedBufferData"));
+	gl_features.NamedBufferSubData = reinterpret_cast< PFNGLNAMEDBUFFERSUBDATAPROC >(get(&gl_features.direct_state_access, "glNamedBufferSubData"));
+
+	if (has("GL_ARB_parallel_shader_compile")) {
+		gl_features.parallel_shader_compile = true;
+		gl_features.MaxShaderCompilerThreads = reinterpret_cast< PFNGLMAXSHADERCOMPILERTHREADSARBPROC >(get(&gl_features.parallel_shader_compile, "glMaxShaderCompilerThreadsARB"));
+	} else if (has("GL_KHR_parallel_shader_compile")) {
+		gl_features.parallel_shader_compile = true;
+		gl_features.MaxShaderCompilerThreads = reinterpret_cast< PFNGLMAXSHADERCOMPILERTHREADSARBPROC >(get(&gl_features.parallel_shader_compile, "glMaxShaderCompilerThreadsKHR"));
+	}
+
+	std::cout << "OpenGL " << gl_features.major << "." << gl_features.minor << " core;"
+		<< (gl_features.buffer_storage ? " buffer_storage" : "")
+		<< (gl_features.multi_draw_indirect ? " multi_draw_indirect" : "")
+		<< (gl_features.direct_state_access ? " direct_state_access" : "")
+		<< (gl_features.parallel_shader_compile ? " parallel_shader_compile" : "")
+		<< std::endl;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <SDL.h>
+
+//"gl_features.hpp" records what the current context can do beyond the 3.3 core
+// baseline, so that the renderer can take faster paths where they exist.
+//
+//Entry points newer than 3.3 are never called through prototypes (not every
+// libGL exports them); they are looked up with SDL_GL_GetProcAddress and are
+// only non-null when the matching feature flag is set.
+
+struct GLFeatures {
+	//version of the context that was actually created:
+	int major = 3;
+	int minor = 3;
+	bool version_at_least(int want_major, int want_minor) const {
+		return major > want_major || (major == want_major && minor >= want_minor);
+	}
+
+	//core in 4.4 / ARB_buffer_storage -- immutable storage + persistent mapping:
+	bool buffer_storage = false;
+	PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+	//core in 4.3 / ARB_multi_draw_indirect (+ base instance, core in 4.2 / ARB_base_instance):
+	bool multi_draw_indirect = false;
+	PFNGLMULTIDRAWARRAYSINDIRECTPROC MultiDrawArraysIndirect = nullptr;
+
+	//core in 4.5 / ARB_direct_state_access -- edit buffers without binding them:
+	bool direct_state_access = false;
+	PFNGLNAMEDBUFFERDATAPROC NamedBufferData = nullptr;
+	PFNGLNAMEDBUFFERSUBDATAPROC NamedBufferSubData = nullptr;
+
+	//ARB_parallel_shader_compile (or KHR_) -- let the driver compile on its own threads:
+	bool parallel_shader_compile = false;
+	PFNGLMAXSHADERCOMPILERTHREADSARBPROC MaxShaderCompilerThreads = nullptr;
+};
+
+extern GLFeatures gl_features;
+
+//fill in gl_features from the current context; call once, right after creating it:
+void init_gl_features();
+
+//create the highest-version core context 'window' supports (falling back to 3.3);
+// returns null (with SDL_GetError() set) on failure:
+SDL_GLContext create_best_gl_context(SDL_Window *window);
@@ -360,4 +360,34 @@ DO(TEXIMAGE3DMULTISAMPLE, TexImage3DMultisample)
 DO(GETMULTISAMPLEFV, GetMultisamplefv)
 DO(SAMPLEMASKI, SampleMaski)
 
+// GL_VERSION_3_3 extensions:
+DO(BINDFRAGDATALOCATIONINDEXED, BindFragDataLocationIndexed)
+DO(GETFRAGDATAINDEX, GetFragDataIndex)
+DO(GENSAMPLERS, GenSamplers)
+DO(DELETESAMPLERS, DeleteSamplers)
+DO(ISSAMPLER, IsSampler)
+DO(BINDSAMPLER, BindSampler)
+DO(SAMPLERPARAMETERI, SamplerParameteri)
+DO(SAMPLERPARAMETERIV, SamplerParameteriv)
+DO(SAMPLERPARAMETERF, SamplerParameterf)
+DO(SAMPLERPARAMETERFV, SamplerParameterfv)
+DO(SAMPLERPARAMETERIIV, SamplerParameterIiv)
+DO(SAMPLERPARAMETERIUIV, SamplerParameterIuiv)
+DO(GETSAMPLERPARAMETERIV, GetSamplerParameteriv)
+DO(GETSAMPLERPARAMETERIIV, GetSamplerParameterIiv)
+DO(GETSAMPLERPARAMETERFV, GetSamplerParameterfv)
+DO(GETSAMPLERPARAMETERIUIV, GetSamplerParameterIuiv)
+DO(QUERYCOUNTER, QueryCounter)
+DO(GETQUERYOBJECTI64V, GetQueryObjecti64v)
+DO(GETQUERYOBJECTUI64V, GetQueryObjectui64v)
+DO(VERTEXATTRIBDIVISOR, VertexAttribDivisor)
+DO(VERTEXATTRIBP1UI, VertexAttribP1ui)
+DO(VERTEXATTRIBP1UIV, VertexAttribP1uiv)
+DO(VERTEXATTRIBP2UI, VertexAttribP2ui)
+DO(VERTEXATTRIBP2UIV, VertexAttribP2uiv)
+DO(VERTEXATTRIBP3UI, VertexAttribP3ui)
+DO(VERTEXATTRIBP3UIV, VertexAttribP3uiv)
+DO(VERTEXATTRIBP4UI, VertexAttribP4ui)
+DO(VERTEXATTRIBP4UIV, VertexAttribP4uiv)
+
 #endif //GL_SHIMS_HPP
@@ -0,0 +1,18 @@
+#include "gl_state.hpp"
+
+GLState gl_state;
+
+void GLState::invalidate() {
+	program_known = false;
+	vao_known = false;
+	for (int i = 0; i < BufferSlots; ++i) {
+		buffer_known[i] = false;
+	}
+	for (int i = 0; i < CapSlots; ++i) {
+		caps[i] = CapUnknown;
+	}
+	blend_known = false;
+	depth_func_known = false;
+	depth_mask_known = false;
+	clear_color_known = false;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//"gl_state.hpp" shadows a small amount of OpenGL context state so that calls
+// which would not change anything can be skipped.
+// (This matters most on drivers where every call is expensive, e.g. software GL.)
+//
+//All binds/enables for tracked state must go through gl_state; if some other
+// code touches the context directly, call gl_state.invalidate() afterward.
+//When deleting an object that may be bound, call the matching forget_*()
+// (GL silently unbinds deleted objects, and the shadow copy must follow).
+
+struct GLState {
+	void use_program(GLuint program) {
+		if (program_known && program == bound_program) { ++elided; return; }
+		glUseProgram(program);
+		bound_program = program;
+		program_known = true;
+		++issued;
+	}
+
+	void bind_vertex_array(GLuint vao) {
+		if (vao_known && vao == bound_vao) { ++elided; return; }
+		glBindVertexArray(vao);
+		bound_vao = vao;
+		vao_known = true;
+		++issued;
+	}
+
+	//GL_ELEMENT_ARRAY_BUFFER is vertex array state and is never cached:
+	void bind_buffer(GLenum target, GLuint buffer) {
+		int slot = buffer_slot(target);
+		if (slot < 0) {
+			glBindBuffer(target, buffer);
+			++issued;
+			return;
+		}
+		if (buffer_known[slot] && buffer == bound_buffers[slot]) { ++elided; return; }
+		glBindBuffer(target, buffer);
+		bound_buffers[slot] = buffer;
+		buffer_known[slot] = true;
+		++issued;
+	}
+
+	void set_enabled(GLenum cap, bool enable) {
+		int slot = cap_slot(cap);
+		if (slot >= 0) {
+			uint8_t want = enable ? CapOn : CapOff;
+			if (caps[slot] == want) { ++elided; return; }
+			caps[slot] = want;
+		}
+		if (enable) glEnable(cap);
+		else glDisable(cap);
+		++issued;
+	}
+	void enable(GLenum cap) { set_enabled(cap, true); }
+	void disable(GLenum cap) { set_enabled(cap, false); }
+
+	void blend_func(GLenum sfactor, GLenum dfactor) {
+		if (blend_known && sfactor == blend_src && dfactor == blend_dst) { ++elided; return; }
+		glBlendFunc(sfactor, dfactor);
+		blend_src = sfactor;
+		blend_dst = dfactor;
+		blend_known = true;
+		++issued;
+	}
+
+	void depth_func(GLenum func) {
+		if (depth_func_known && func == current_depth_func) { ++elided; return; }
+		glDepthFunc(func);
+		current_depth_func = func;
+		depth_func_known = true;
+		++issued;
+	}
+
+	void depth_mask(GLboolean flag) {
+		if (depth_mask_known && flag == current_depth_mask) { ++elided; return; }
+		glDepthMask(flag);
+		current_depth_mask = flag;
+		depth_mask_known = true;
+		++issued;
+	}
+
+	void clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+		if (clear_color_known && r == current_clear_color[0] && g == current_clear_color[1] && b == current_clear_color[2] && a == current_clear_color[3]) { ++elided; return; }
+		glClearColor(r, g, b, a);
+		current_clear_color[0] = r; current_clear_color[1] = g; current_clear_color[2] = b; current_clear_color[3] = a;
+		clear_color_known = true;
+		++issued;
+	}
+
+	void forget_program(GLuint program) { if (program == bound_program) program_known = false; }
+	void forget_vertex_array(GLuint vao) { if (vao == bound_vao) vao_known = false; }
+	void forget_buffer(GLuint buffer) {
+		for (int i = 0; i < BufferSlots; ++i) {
+			if (bound_buffers[i] == buffer) buffer_known[i] = false;
+		}
+	}
+
+	//forget everything (next call to each setter will be issued):
+	void invalidate();
+
+	//call counters (cumulative; reset by whoever is reporting them):
+	uint64_t issued = 0;
+	uint64_t elided = 0;
+
+private:
+	enum : uint8_t { CapUnknown = 0, CapOff = 1, CapOn = 2 };
+
+	static int cap_slot(GLenum cap) {
+		switch (cap) {
+			case GL_DEPTH_TEST: return 0;
+			case GL_BLEND: return 1;
+			case GL_CULL_FACE: return 2;
+			case GL_SCISSOR_TEST: return 3;
+			case GL_STENCIL_TEST: return 4;
+			case GL_FRAMEBUFFER_SRGB: return 5;
+			default: return -1;
+		}
+	}
+	enum { CapSlots = 6 };
+
+	static int buffer_slot(GLenum target) {
+		switch (target) {
+			case GL_ARRAY_BUFFER: return 0;
+			case GL_COPY_READ_BUFFER: return 1;
+			case GL_COPY_WRITE_BUFFER: return 2;
+			case GL_PIXEL_PACK_BUFFER: return 3;
+			case GL_PIXEL_UNPACK_BUFFER: return 4;
+			case GL_UNIFORM_BUFFER: return 5;
+			case GL_DRAW_INDIRECT_BUFFER: return 6;
+			default: return -1;
+		}
+	}
+	enum { BufferSlots = 7 };
+
+	GLuint bound_program = 0;
+	bool program_known = false;
+
+	GLuint bound_vao = 0;
+	bool vao_known = false;
+
+	GLuint bound_buffers[BufferSlots] = { 0, 0, 0, 0, 0, 0 };
+	bool buffer_known[BufferSlots] = { false, false, false, false, false, false };
+
+	uint8_t caps[CapSlots] = { CapUnknown, CapUnknown, CapUnknown, CapUnknown, CapUnknown, CapUnknown };
+
+	GLenum blend_src = 0, blend_dst = 0;
+	bool blend_known = false;
+
+	GLenum current_depth_func = 0;
+	bool depth_func_known = false;
+
+	GLboolean current_depth_mask = GL_TRUE;
+	bool depth_mask_known = false;
+
+	GLfloat current_clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	bool clear_color_known = false;
+};
+
+//state shadow for the (single) OpenGL context:
+extern GLState gl_state;
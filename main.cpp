@@ -3,6 +3,29 @@
 
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
+//...and gl_features.hpp says what the context can do beyond OpenGL 3.3:
+#include "gl_features.hpp"
+
+//The renderer runs on its own thread and draws whatever Game::draw emits:
+#include "RenderThread.hpp"
+//...and the main loop is paced by a FramePacer:
+#include "FramePacer.hpp"
+
+//...and runtime settings come from the command line and a config file:
+#include "Options.hpp"
+//...and runs can be recorded and played back:
+#include "Replay.hpp"
+//...and recent game states can be kept for rewinding:
+#include "SnapshotRing.hpp"
+//...and a bot can play by trying launches on copies of the game:
+#include "LaunchPlanner.hpp"
+
+//...and heap allocations are counted by zone:
+#include "allocation_tracker.hpp"
+
+//...mesh data is shared between the game and the renderer:
+#include "MeshBuffer.hpp"
+#include "data_path.hpp"
 
 //Includes for libSDL:
 #include <SDL.h>
@@ -19,20 +42,82 @@
 #include <fstream>
 #include <memory>
 #include <algorithm>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 
 int main(int argc, char **argv) {
-	struct {
-		//TODO: this is where you set the title and size of your game window
-		std::string title = "Egg Hoarder";
-		glm::uvec2 size = glm::uvec2(640, 400);
-	} config;
+	Options config;
+	try {
+		std::vector< Options::Setting > args, settings;
+		Options::read_args(argc, argv, &args);
+		for (Options::Setting const &arg : args) {
+			if (arg.name == "help") {
+				std::cout << Options::usage();
+				return 0;
+			}
+		}
+		//the config file (if any) comes first, so the command line overrides it:
+		std::string config_file = user_path("options.txt");
+		bool config_required = false;
+		for (Options::Setting const &arg : args) {
+			if (arg.name == "config") {
+				config_file = arg.value;
+				config_required = true;
+			}
+		}
+		Options::read_file(config_file, config_required, &settings);
+		settings.insert(settings.end(), args.begin(), args.end());
+		config.apply(settings);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl << Options::usage();
+		return 1;
+	}
+
+	//a replay brings its own input, time steps, and seed:
+	Replay playback;
+	bool const replaying = !config.replay_in.empty();
+	if (replaying) {
+		try {
+			playback = Replay::load(config.replay_in);
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		if (playback.scenario.name != config.scenario.name) {
+			std::cerr << "NOTE: replay was recorded with scenario '" << playback.scenario.name << "', not '" << config.scenario.name << "'; playing it with the recorded one." << std::endl;
+		}
+		config.scenario = playback.scenario;
+		config.seed = config.scenario.seed = playback.seed;
+		if (config.frames == 0 || config.frames > playback.frames.size()) {
+			config.frames = uint32_t(playback.frames.size());
+		}
+	}
+	bool const recording = !config.replay_out.empty();
+	Replay record;
+	record.seed = config.seed;
+	record.scenario = config.scenario;
+
+	if (config.offscreen && config.frames == 0) {
+		std::cerr << "NOTE: --offscreen without --frames will run until killed." << std::endl;
+	}
 
 	//------------  initialization ------------
 
+	//Render without a display using SDL's "offscreen" video driver (EGL pbuffers, e.g. on Mesa):
+	if (config.offscreen) {
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+	}
+
 	//Initialize SDL library:
-	SDL_Init(SDL_INIT_VIDEO);
+	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+		std::cerr << "Error initializing SDL: " << SDL_GetError() << std::endl;
+		return 1;
+	}
 
-	//Ask for an OpenGL context version 3.3, core profile, enable debug:
+	//Ask for an OpenGL core profile context (the newest available, at least 3.3; see below), enable debug:
 	SDL_GL_ResetAttributes();
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
@@ -43,15 +128,14 @@ int main(int argc, char **argv) {
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
 	//create window:
 	SDL_Window *window = SDL_CreateWindow(
 		config.title.c_str(),
 		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
 		config.size.x, config.size.y,
-		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI
+		SDL_WINDOW_OPENGL | (config.offscreen ? SDL_WINDOW_HIDDEN : (SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI
+			| (config.fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0)))
 	);
 
 	//prevent exceedingly tiny windows when resizing:
@@ -62,8 +146,8 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
-	//Create OpenGL context:
-	SDL_GLContext context = SDL_GL_CreateContext(window);
+	//Create OpenGL context (trying newer versions first):
+	SDL_GLContext context = create_best_gl_context(window);
 
 	if (!context) {
 		SDL_DestroyWindow(window);
@@ -76,10 +160,23 @@ int main(int argc, char **argv) {
 	init_gl_shims();
 	#endif
 
-	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
-		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
-		if (SDL_GL_SetSwapInterval(1) != 0) {
+	//Find out which fast paths the renderer may use:
+	init_gl_features();
+
+	//Set VSYNC (+ Late Swap, if adaptive; prevents crazy FPS):
+	if (config.offscreen) {
+		SDL_GL_SetSwapInterval(0); //(offscreen runs are benchmarks: go as fast as possible)
+	} else if (config.vsync == Options::VSyncOff) {
+		if (SDL_GL_SetSwapInterval(0) != 0) {
+			std::cerr << "NOTE: couldn't turn off vsync (" << SDL_GetError() << ")." << std::endl;
+		}
+	} else {
+		bool adaptive = false;
+		if (config.vsync == Options::VSyncAdaptive) {
+			adaptive = (SDL_GL_SetSwapInterval(-1) == 0);
+			if (!adaptive) std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
+		}
+		if (!adaptive && SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
 		}
 	}
@@ -87,10 +184,26 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
+	//The context belongs to the render thread from here on:
+	SDL_GL_MakeCurrent(window, NULL);
+
 
-	//------------ create game object (loads assets) --------------
+	//------------ load assets, start renderer, create game object --------------
 
-	std::shared_ptr< Game > game = std::make_shared< Game >();
+	std::unique_ptr< RenderThread > render_thread;
+	std::shared_ptr< Game > game;
+	std::unique_ptr< LaunchPlanner > planner; //(if "--bot")
+	{
+		MeshBuffer meshes(data_path("meshes.blob"));
+
+		//(both of these copy what they need out of 'meshes'):
+		RenderThread::Settings settings;
+		settings.capture_prefix = config.capture_prefix;
+		settings.max_frames_in_flight = config.max_frames_in_flight;
+		render_thread.reset(new RenderThread(window, context, meshes, settings));
+		game = std::make_shared< Game >(meshes, config.scenario);
+		if (config.bot && !replaying) planner.reset(new LaunchPlanner(meshes, config.scenario));
+	}
 
 	//------------ main loop ------------
 
@@ -106,15 +219,91 @@ int main(int argc, char **argv) {
 		window_size = glm::uvec2(w, h);
 		SDL_GL_GetDrawableSize(window, &w, &h);
 		drawable_size = glm::uvec2(w, h);
-		glViewport(0, 0, drawable_size.x, drawable_size.y);
+		//(the renderer updates the viewport when it sees a new drawable size)
 	};
 	on_resize();
 
+	//In offscreen mode, the player is scripted: each round turns a bit, charges for
+	// a varying time, and launches:
+	//(scripted runs also keep their own event clock, in step with the fixed time step)
+	uint32_t const script_rate = (config.tick_rate ? config.tick_rate : 60);
+	auto script_ticks = [script_rate](uint32_t frame) {
+		return uint32_t(uint64_t(frame) * 1000 / script_rate);
+	};
+	auto script_events = [&script_ticks](uint32_t frame, std::vector< SDL_Event > *_events) {
+		assert(_events);
+		uint32_t round = frame / 150;
+		uint32_t t = frame % 150;
+		auto key = [&](Uint32 type, SDL_Scancode scancode) {
+			SDL_Event evt;
+			std::memset(&evt, 0, sizeof(evt));
+			evt.type = type;
+			evt.key.timestamp = script_ticks(frame);
+			evt.key.keysym.scancode = scancode;
+			_events->emplace_back(evt);
+		};
+		SDL_Scancode turn = (round % 2 ? SDL_SCANCODE_RIGHT : SDL_SCANCODE_LEFT);
+		if (t == 0) key(SDL_KEYDOWN, turn);
+		if (t == 5 + round % 20) key(SDL_KEYUP, turn);
+		if (t == 30) key(SDL_KEYDOWN, SDL_SCANCODE_SPACE);
+		if (t == 30 + 20 + (round * 7) % 40) key(SDL_KEYUP, SDL_SCANCODE_SPACE);
+	};
+	std::vector< SDL_Event > scripted; //(kept to avoid reallocation)
+
+	//"--bot" tries a grid of launches ahead of time whenever it is the player's turn;
+	// the plan runs in the background (the bot waits, keys up, until it's done):
+	float const BotHorizon = 6.0f; //seconds (enough to aim, charge, and fly)
+	std::vector< LaunchPlanner::Launch > const bot_candidates = LaunchPlanner::launch_grid(36, 11);
+	LaunchPlanner::Aim bot_aim;
+	Game::Input bot_held;
+	bool bot_planned = false; //(started a plan this turn)
+	bool bot_aimed = false; //(...and got its result)
+	uint32_t bot_round = 0;
+
+	//with a tick rate, update() runs in fixed steps, carrying the remainder between frames:
+	float const tick = (config.tick_rate ? 1.0f / float(config.tick_rate) : 0.0f);
+	float tick_accumulator = 0.0f;
+
+	//"--profile" keeps per-frame timings, written out at exit:
+	struct ProfileRow {
+		uint32_t steps;
+		float update_ms, draw_ms, frame_ms;
+	};
+	std::vector< ProfileRow > profile;
+	if (!config.profile_out.empty()) profile.reserve(config.frames ? config.frames : 60 * 60);
+	auto previous_input_time = PacingClock::now();
+
+	//"--rewind" keeps snapshots of the game at a fixed rate of simulated time:
+	uint32_t const SnapshotsPerSecond = 30;
+	std::unique_ptr< SnapshotRing > rewind;
+	if (config.rewind > 0 && !replaying && !recording) {
+		rewind.reset(new SnapshotRing(config.rewind * SnapshotsPerSecond, SnapshotsPerSecond));
+	}
+	float snapshot_time = 0.0f; //simulated time since the last snapshot
+	std::vector< uint8_t > snapshot; //(kept to avoid reallocation)
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+	uint32_t frame = 0;
+
+	FramePacer pacer;
+	pacer.max_fps = config.max_fps;
+
+	//frames before this are warm-up (containers reach their working sizes) and aren't checked:
+	uint32_t const AllocationCheckFrame = 120;
+	bool allocation_check_failed = false;
+
 	//This will loop until the game object is set to null:
 	while (game) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
+		//(0) wait for the frame cap (if any) *before* sampling input, so the input is fresh:
+		pacer.wait_for_next_frame();
+		auto input_time = PacingClock::now();
+		uint32_t ticks = 0; //input sample time on SDL's event clock (set once events are polled)
+
+		if (recording) record.begin_frame();
+
 		{ //(1) process any events that are pending
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
@@ -122,7 +311,27 @@ int main(int argc, char **argv) {
 				if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					on_resize();
 				}
-				//handle input:
+				//cycle shading tiers:
+				if (evt.type == SDL_KEYDOWN && !evt.key.repeat && evt.key.keysym.scancode == SDL_SCANCODE_F2) {
+					config.shading_tier = ShadingTier((config.shading_tier + 1) % ShadingTiers);
+					continue;
+				}
+				//step back a second:
+				if (rewind && evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_BACKSPACE) {
+					if (rewind->size() > 0) {
+						uint32_t age = std::min(rewind->size() - 1, SnapshotsPerSecond);
+						rewind->get(age, &snapshot);
+						game->load_state(snapshot);
+						rewind->drop_newest(age);
+						snapshot_time = 0.0f;
+					}
+					continue;
+				}
+				//handle input (unless the player is scripted, replayed, or a bot):
+				if ((config.offscreen || replaying || planner) && evt.type != SDL_QUIT) {
+					continue;
+				}
+				if (recording) record.add_key(evt);
 				if (game && game->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
@@ -131,8 +340,60 @@ int main(int argc, char **argv) {
 				}
 			}
 			if (!game) break;
+
+			//(event timestamps come from the same clock)
+			ticks = SDL_GetTicks();
+
+			if (replaying) {
+				ticks = playback.frames[frame].ticks;
+				scripted.clear();
+				playback.get_keys(frame, &scripted);
+			} else if (planner) {
+				if (config.offscreen) ticks = script_ticks(frame);
+				//plan each launch once aiming starts, then steer toward it:
+				if (game->rounds != bot_round || game->game_state == Game::flying) {
+					bot_planned = false;
+					bot_aimed = false;
+				}
+				bot_round = game->rounds;
+				LaunchPlanner::Launch launch;
+				if (planner->poll(&launch) && bot_planned) { //(plans from an earlier turn are ignored)
+					bot_aim.launch = launch;
+					bot_aimed = true;
+				}
+				if (game->game_state == Game::aiming && !bot_planned && !planner->busy()) {
+					planner->start(*game, bot_candidates, BotHorizon);
+					bot_planned = true;
+					//(scripted runs wait for the plan, so that they play the same every time)
+					if (config.offscreen) {
+						planner->wait();
+						bot_aimed = planner->poll(&bot_aim.launch);
+					}
+				}
+				Game::Input input;
+				if (bot_aimed) input = bot_aim(*game);
+				SDL_Event events[3];
+				uint32_t count = Game::input_events(bot_held, input, ticks, events);
+				bot_held = input;
+				scripted.assign(events, events + count);
+			} else if (config.offscreen) {
+				ticks = script_ticks(frame);
+				scripted.clear();
+				script_events(frame, &scripted);
+			}
+			if (replaying || planner || config.offscreen) {
+				for (SDL_Event const &evt : scripted) {
+					if (recording) record.add_key(evt);
+					game->handle_event(evt, window_size);
+				}
+			}
+			if (recording) record.frames.back().ticks = ticks;
 		}
 
+		uint32_t steps = 0; //update() calls this frame
+		PacingClock::time_point update_start;
+		uint64_t frame_allocations = allocation_counts(ZoneUpdate).allocations + allocation_counts(ZoneDraw).allocations;
+
 		{ //(2) call the game's "update" function to deal with elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
@@ -143,33 +404,163 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			game->update(elapsed);
+			update_start = PacingClock::now();
+			AllocationZone zone(ZoneUpdate);
+			//each step gets the input time less the simulated time still ahead of it this frame,
+			//  so the last step lands on the frame's ticks:
+			auto step = [&](float dt, float ahead) {
+				if (recording) {
+					AllocationZone other(ZoneOther); //(the recording grows; that's not the game's doing)
+					record.add_step(dt);
+				}
+				game->update(dt, ticks - uint32_t(ahead * 1000.0f + 0.5f));
+				steps += 1;
+				snapshot_time += dt;
+			};
+			if (replaying) {
+				Replay::Frame const &played = playback.frames[frame];
+				float ahead = 0.0f;
+				for (uint32_t s = played.steps_begin; s < played.steps_end; ++s) {
+					ahead += playback.steps[s];
+				}
+				for (uint32_t s = played.steps_begin; s < played.steps_end; ++s) {
+					ahead -= playback.steps[s];
+					step(playback.steps[s], std::max(0.0f, ahead));
+				}
+			} else if (config.offscreen) {
+				//scripted runs take one fixed step per frame, so that they don't depend on machine speed:
+				step(1.0f / float(script_rate), 0.0f);
+			} else if (config.tick_rate) {
+				tick_accumulator += elapsed;
+				uint32_t count = 0;
+				while (tick_accumulator >= tick) {
+					tick_accumulator -= tick;
+					count += 1;
+				}
+				for (uint32_t s = 0; s < count; ++s) {
+					step(tick, tick * float(count - 1 - s));
+				}
+			} else {
+				step(elapsed, 0.0f);
+			}
 			if (!game) break;
 		}
+		auto update_done = PacingClock::now();
+
+		if (rewind && snapshot_time >= 1.0f / SnapshotsPerSecond) {
+			snapshot_time = std::fmod(snapshot_time, 1.0f / SnapshotsPerSecond);
+			snapshot.clear();
+			game->save_state(&snapshot);
+			rewind->push(snapshot);
+		}
 
 		{ //(3) call the game's "draw" function to produce output:
-			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			DrawList &list = render_thread->next_frame();
+			{
+				AllocationZone zone(ZoneDraw);
+				game->draw(drawable_size, &list);
+			}
+			list.shading_tier = config.shading_tier;
+			list.input_time = input_time;
 
-			game->draw(drawable_size);
+			//hand the frame to the render thread, which clears, draws, and swaps
+			// while we move on to simulating the next frame:
+			render_thread->submit();
 		}
 
-		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		if (!config.profile_out.empty()) {
+			auto draw_done = PacingClock::now();
+			profile.emplace_back(ProfileRow{
+				steps,
+				std::chrono::duration< float, std::milli >(update_done - update_start).count(),
+				std::chrono::duration< float, std::milli >(draw_done - update_done).count(),
+				std::chrono::duration< float, std::milli >(input_time - previous_input_time).count()
+			});
+			previous_input_time = input_time;
+		}
+
+		frame_allocations = allocation_counts(ZoneUpdate).allocations + allocation_counts(ZoneDraw).allocations - frame_allocations;
+		if (config.check_allocations && frame >= AllocationCheckFrame && frame_allocations != 0) {
+			std::cerr << "ERROR: frame " << frame << " made " << frame_allocations << " heap allocations in update/draw." << std::endl;
+			allocation_check_failed = true;
+			break;
+		}
+
+		frame += 1;
+		if (config.frames != 0 && frame >= config.frames) break;
 	}
+	float run_time = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - start_time).count();
 
 
 	//------------  teardown ------------
 
+	if (recording) {
+		try {
+			record.save(config.replay_out);
+			std::cout << "Recorded " << record.frames.size() << " frames to '" << config.replay_out << "'." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+		}
+	}
+	if (!config.profile_out.empty()) {
+		std::ofstream csv(config.profile_out);
+		csv << "frame,steps,update_ms,draw_ms,frame_ms\n";
+		for (uint32_t f = 0; f < profile.size(); ++f) {
+			csv << f << "," << profile[f].steps << "," << profile[f].update_ms << "," << profile[f].draw_ms << "," << profile[f].frame_ms << "\n";
+		}
+		if (!csv) std::cerr << "Failed writing profile '" << config.profile_out << "'." << std::endl;
+	}
+
+	if (game && config.scenario.name != "game") {
+		std::cout << "Scenario '" << config.scenario.name << "': " << game->world.size() << " entities at exit ("
+			<< game->enemies_spawned << " enemies spawned)." << std::endl;
+	}
+	if (planner) {
+		planner->wait();
+		if (planner->plans) {
+			std::cout << "Bot: " << planner->plans << " plans of " << planner->launches_tried / planner->plans << " launches, "
+				<< planner->plan_ms_total / planner->plans << "ms mean (" << planner->plan_ms_max << "ms max) in the background, "
+				<< planner->start_ms_total / planner->plans << "ms mean (" << planner->start_ms_max << "ms max) on the main thread." << std::endl;
+		}
+	}
+	game.reset();
+	planner.reset();
+
+	//stop the render thread (releases the context):
+	render_thread->stop();
+
+	{ //report some per-frame averages:
+		RenderThread::Totals const &totals = render_thread->totals;
+		double frames = double(totals.frames);
+		if (frames > 0.0) {
+			std::cout << "Drew " << totals.frames << " frames in " << run_time << "s (" << frames / run_time << " fps); per frame: "
+				<< double(totals.draws) / frames << " draw calls, "
+				<< double(totals.culled) / frames << " objects culled, "
+				<< double(totals.gl_elided) / frames << " redundant GL calls skipped (of "
+				<< double(totals.gl_elided + totals.gl_issued) / frames << ")." << std::endl;
+			std::cout << "Instance ring: " << totals.ring_waits << " stalls, " << totals.ring_grows << " grows." << std::endl;
+			std::cout << "Dynamic resolution: " << totals.scaled_frames << " frames drawn below full resolution." << std::endl;
+			std::cout << "Frame time: " << pacer.frame_ms.mean << "ms mean, " << std::sqrt(pacer.frame_ms.variance()) << "ms std. dev., " << pacer.frame_ms.max << "ms max." << std::endl;
+			std::cout << "Input-to-GPU-done latency (by GPU timestamp): " << totals.latency_ms.mean << "ms mean, " << totals.latency_ms.max << "ms max"
+				<< " (at most " << config.max_frames_in_flight << " frames in flight; full " << totals.queue_waits << " times)." << std::endl;
+			if (!config.capture_prefix.empty()) {
+				std::cout << "Captured " << totals.captured << " frames (" << totals.capture_waits << " readback stalls)." << std::endl;
+			}
+			std::cout << "Heap allocations:";
+			for (uint32_t z = 0; z < AllocationZones; ++z) {
+				AllocationCounts counts = allocation_counts(AllocationZoneId(z));
+				std::cout << (z ? ", " : " ") << allocation_zone_name(AllocationZoneId(z)) << " " << counts.allocations << " (" << counts.bytes / 1024 << "kB)";
+			}
+			std::cout << "." << std::endl;
+		}
+	}
+	render_thread.reset();
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
 	SDL_DestroyWindow(window);
 	window = NULL;
 
-	return 0;
+	return allocation_check_failed ? 1 : 0;
 }
@@ -0,0 +1,42 @@
+#include "save_png.hpp"
+
+#include <png.h>
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+void save_png(std::string const &filename, glm::uvec2 size, uint8_t const *rgba) {
+	std::unique_ptr< FILE, int(*)(FILE *) > file(std::fopen(filename.c_str(), "wb"), std::fclose);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info = png ? png_create_info_struct(png) : nullptr;
+	if (!png || !info) {
+		png_destroy_write_struct(&png, &info);
+		throw std::runtime_error("Failed to create libpng write structures.");
+	}
+
+	//flip rows so that the top of the image comes first:
+	std::vector< png_const_bytep > rows(size.y);
+	for (uint32_t y = 0; y < size.y; ++y) {
+		rows[y] = rgba + size_t(size.y - 1 - y) * size.x * 4;
+	}
+
+	//libpng reports errors by longjmp-ing back here:
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		throw std::runtime_error("Failed to write PNG '" + filename + "'.");
+	}
+
+	png_init_io(png, file.get());
+	png_set_IHDR(png, info, size.x, size.y, 8, PNG_COLOR_TYPE_RGBA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	png_write_rows(png, const_cast< png_bytepp >(rows.data()), size.y);
+	png_write_end(png, nullptr);
+	png_destroy_write_struct(&png, &info);
+}
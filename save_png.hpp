@@ -0,0 +1,11 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <cstdint>
+
+//save_png writes 'size.x' by 'size.y' RGBA pixels to a PNG file (throws on failure).
+// Rows are given bottom-to-top (as glReadPixels returns them):
+//   save_png("frame.png", size, pixels.data());
+void save_png(std::string const &filename, glm::uvec2 size, uint8_t const *rgba);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+
+//default_worker_threads is how many threads a background pool (FrameCapture,
+// LaunchPlanner) starts when not told: what's left after a core each for the game
+// and the render thread, and at least one:
+inline uint32_t default_worker_threads() {
+	uint32_t cores = std::thread::hardware_concurrency(); //(0 if unknown)
+	return cores > 3 ? cores - 2 : 1U;
+}